@@ -0,0 +1,657 @@
+/*
+ * Headless benchmark of the detection pipeline. Runs the same classes the app
+ * uses over recorded or synthetic frames and reports per-stage latency
+ * percentiles, throughput and heap allocations per frame.
+ *
+ * The background model and the hand detector's morphology are also timed
+ * the way they used to run, with RunningBackground and iterated cv::erode
+ * and cv::dilate. Afterwards, controls are detected on a large sheet covered
+ * in sketches, with ControlDetector and the way it used to classify
+ * contours, and the same few controls on unwarped images of growing
+ * resolution, with and without the detector's pyramid. Then OSC messages
+ * are encoded with OscEncoder and the way ofxOsc did it.
+ *
+ * Only the times are compared here. sketchSynth_check ("make Check") checks
+ * that each pair gives the same results.
+ *
+ *   sketchSynth_bench [--replay <path>] [--frames <n>] [--warmup <n>]
+ *                     [--controls <n>] [--sheet-controls <n>] [--sheet-passes <n>]
+ *                     [--osc-messages <n>] [--format text|json|csv]
+ *
+ * Build with "make Bench" and run from the bin directory.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <new>
+#include <time.h>
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "ControlDetector.h"
+#include "ControlManager.h"
+#include "HandDetector.h"
+#include "PaperDetector.h"
+#include "Settings.h"
+#include "VisionPipeline.h"
+
+#include "DetectorBenchmark.h"
+#include "FrameFeed.h"
+#include "OscBenchmark.h"
+#include "SyntheticScene.h"
+
+using cv::Mat;
+
+//---------------------------------------------------------
+// Count every heap allocation so stages can be checked for per-frame churn.
+// With glibc, malloc itself is replaced, which also catches cv::Mat buffers
+// (cv::fastMalloc) and C code; elsewhere only C++ new is seen.
+static volatile bool countAllocations = false;
+static volatile unsigned long allocations = 0;
+
+static inline void countAllocation() {
+    if (countAllocations) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+}
+
+#ifdef __GLIBC__
+static const char *allocationsCounted = "malloc and new";
+
+extern "C" {
+    void* __libc_malloc(size_t size);
+    void* __libc_calloc(size_t n, size_t size);
+    void* __libc_realloc(void *p, size_t size);
+    void* __libc_memalign(size_t alignment, size_t size);
+
+    void* malloc(size_t size) __THROW {
+        countAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t n, size_t size) __THROW {
+        countAllocation();
+        return __libc_calloc(n, size);
+    }
+
+    void* realloc(void *p, size_t size) __THROW {
+        countAllocation();
+        return __libc_realloc(p, size);
+    }
+
+    int posix_memalign(void **out, size_t alignment, size_t size) __THROW {
+        countAllocation();
+        void *p = __libc_memalign(alignment, size);
+        if (p == NULL) {
+            return ENOMEM;
+        }
+        *out = p;
+        return 0;
+    }
+}
+
+// new goes through the malloc above, which does the counting
+static inline void countNew() {}
+#else
+static const char *allocationsCounted = "C++ new only";
+
+static inline void countNew() {
+    countAllocation();
+}
+#endif
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    countNew();
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t &) throw() {
+    countNew();
+    return malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t &) throw() {
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void *p) throw() {
+    free(p);
+}
+
+void operator delete[](void *p) throw() {
+    free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) throw() {
+    free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) throw() {
+    free(p);
+}
+
+//---------------------------------------------------------
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+//---------------------------------------------------------
+enum Stage {
+    PAPER_DETECT,
+    PAPER_UNWARP,
+    CONTROL_DETECT,
+    BACKGROUND,
+    BACKGROUND_OFXCV,
+    HAND_FILTER,
+    HAND_FILTER_OPENCV,
+    HAND_CONTOURS,
+    HAND_FINGERS,
+    NUM_STAGES
+};
+
+static const char *stageNames[NUM_STAGES] = {
+    "paper.detect",
+    "paper.unwarp",
+    "controls.detect",
+    "background",
+    "background.ofxcv",
+    "hand.filter",
+    "hand.filter.opencv",
+    "hand.contours",
+    "hand.fingers"
+};
+
+struct StageStats {
+    StageStats() : allocations(0) {}
+
+    vector<double> times;
+    unsigned long allocations;
+
+    double percentile(double p) const {
+        if (times.empty()) {
+            return 0;
+        }
+        vector<double> sorted(times);
+        size_t i = min(sorted.size() - 1, (size_t) (p * sorted.size()));
+        std::nth_element(sorted.begin(), sorted.begin() + i, sorted.end());
+        return sorted[i];
+    }
+
+    double mean() const {
+        double sum = 0;
+        for (size_t i = 0; i < times.size(); i++) {
+            sum += times[i];
+        }
+        return times.empty() ? 0 : sum / times.size();
+    }
+};
+
+// Times one stage of one frame, including the allocations it made
+class StageTimer {
+public:
+    StageTimer(StageStats &stats, bool record)
+        : stats(stats)
+        , record(record)
+        , startAllocations(allocations)
+        , start(now())
+    {}
+
+    ~StageTimer() {
+        double elapsed = now() - start;
+        if (record) {
+            stats.times.push_back(elapsed);
+            stats.allocations += allocations - startAllocations;
+        }
+    }
+
+private:
+    StageStats &stats;
+    bool record;
+    unsigned long startAllocations;
+    double start;
+};
+
+//---------------------------------------------------------
+struct Options {
+    Options()
+        : frames(300)
+        , warmup(30)
+        , controls(6)
+        , sheetControls(300)
+        , sheetPasses(20)
+        , oscMessages(200000)
+        , format("text")
+    {}
+
+    string replay;
+    size_t frames;
+    size_t warmup;
+    int controls;
+    int sheetControls;
+    size_t sheetPasses;
+    size_t oscMessages;
+    string format;
+};
+
+static bool parseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--replay" && hasValue) {
+            options.replay = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = ofToInt(argv[++i]);
+        } else if (arg == "--warmup" && hasValue) {
+            options.warmup = ofToInt(argv[++i]);
+        } else if (arg == "--controls" && hasValue) {
+            options.controls = ofToInt(argv[++i]);
+        } else if (arg == "--sheet-controls" && hasValue) {
+            options.sheetControls = ofToInt(argv[++i]);
+        } else if (arg == "--sheet-passes" && hasValue) {
+            options.sheetPasses = ofToInt(argv[++i]);
+        } else if (arg == "--osc-messages" && hasValue) {
+            options.oscMessages = ofToInt(argv[++i]);
+        } else if (arg == "--format" && hasValue) {
+            options.format = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--replay <path>] [--frames <n>] [--warmup <n>] "
+                    "[--controls <n>] [--sheet-controls <n>] [--sheet-passes <n>] "
+                    "[--osc-messages <n>] [--format text|json|csv]\n", argv[0]);
+            return false;
+        }
+    }
+    return options.format == "text" || options.format == "json" || options.format == "csv";
+}
+
+//---------------------------------------------------------
+struct SheetStats {
+    SheetStats() : width(0), height(0), shapes(0) {}
+
+    int width;
+    int height;
+    size_t shapes;
+    StageStats detect;
+    StageStats legacy;
+};
+
+static SheetStats benchmarkSheet(int controls, size_t passes) {
+    SheetStats stats;
+
+    // Four times the app's unwarped size in each direction, so hundreds of
+    // sketches are still big enough to count as controls
+    stats.width = 518 * 4;
+    stats.height = 400 * 4;
+    Mat sheet(stats.height, stats.width, CV_8UC3, cv::Scalar(235, 235, 230));
+    SyntheticScene::drawControls(sheet, controls);
+
+    // With thresholds at the sheet's own size, the way the old detector
+    // has them
+    ControlDetector detector;
+    detector.setLayoutWidth(stats.width);
+    detector.setPyramid(false);
+    DetectorBenchmark::LegacyDetector legacy;
+    vector<ControlShape> shapes, legacyShapes;
+
+    // One untimed pass of each to size their buffers
+    detector.detect(sheet, shapes);
+    legacy.detect(sheet, legacyShapes);
+    stats.shapes = shapes.size();
+
+    countAllocations = true;
+    for (size_t i = 0; i < passes; i++) {
+        {
+            StageTimer t(stats.detect, true);
+            detector.detect(sheet, shapes);
+        }
+        {
+            StageTimer t(stats.legacy, true);
+            legacy.detect(sheet, legacyShapes);
+        }
+    }
+    countAllocations = false;
+    return stats;
+}
+
+//---------------------------------------------------------
+struct ResolutionStats {
+    ResolutionStats() : width(0), height(0), pyramidShapes(0), fullShapes(0) {}
+
+    int width;
+    int height;
+    StageStats pyramid;
+    StageStats full;
+    size_t pyramidShapes;
+    size_t fullShapes;
+};
+
+static vector<ResolutionStats> benchmarkResolutions(int controls, size_t passes) {
+    vector<ResolutionStats> results;
+
+    // The app's unwarped size and up, with the thresholds scaled to match
+    for (int scale = 1; scale <= 4; scale *= 2) {
+        ResolutionStats stats;
+        stats.width = 518 * scale;
+        stats.height = 400 * scale;
+        Mat sheet(stats.height, stats.width, CV_8UC3, cv::Scalar(235, 235, 230));
+        SyntheticScene::drawControls(sheet, controls);
+
+        ControlDetector pyramid;
+        ControlDetector full;
+        full.setPyramid(false);
+        vector<ControlShape> pyramidShapes, fullShapes;
+
+        pyramid.detect(sheet, pyramidShapes);
+        full.detect(sheet, fullShapes);
+        stats.pyramidShapes = pyramidShapes.size();
+        stats.fullShapes = fullShapes.size();
+
+        countAllocations = true;
+        for (size_t i = 0; i < passes; i++) {
+            {
+                StageTimer t(stats.pyramid, true);
+                pyramid.detect(sheet, pyramidShapes);
+            }
+            {
+                StageTimer t(stats.full, true);
+                full.detect(sheet, fullShapes);
+            }
+        }
+        countAllocations = false;
+        results.push_back(stats);
+    }
+    return results;
+}
+
+//---------------------------------------------------------
+struct OscStats {
+    OscStats() : rate(0), ofxOscRate(0), allocations(0), ofxOscAllocations(0) {}
+
+    // Messages per second, and heap allocations per message
+    double rate;
+    double ofxOscRate;
+    double allocations;
+    double ofxOscAllocations;
+};
+
+static OscStats benchmarkOsc(size_t messages) {
+    OscStats stats;
+    OscEncoder encoder;
+    char buffer[2048];
+    size_t bytes = 0;
+
+    countAllocations = true;
+    unsigned long startAllocations = allocations;
+    double start = now();
+    for (size_t n = 0; n < messages; n++) {
+        bytes += OscBenchmark::encode(n, encoder);
+    }
+    double elapsed = now() - start;
+    stats.rate = elapsed > 0 ? messages / (elapsed / 1e6) : 0;
+    stats.allocations = (double) (allocations - startAllocations) / max((size_t) 1, messages);
+
+    startAllocations = allocations;
+    start = now();
+    for (size_t n = 0; n < messages; n++) {
+        bytes += OscBenchmark::encodeOfxOsc(n, buffer, sizeof(buffer));
+    }
+    elapsed = now() - start;
+    stats.ofxOscRate = elapsed > 0 ? messages / (elapsed / 1e6) : 0;
+    stats.ofxOscAllocations = (double) (allocations - startAllocations) / max((size_t) 1, messages);
+    countAllocations = false;
+
+    // Keeps the encoding from being optimized away
+    if (bytes == 0) {
+        fprintf(stderr, "no OSC bytes encoded\n");
+    }
+    return stats;
+}
+
+//---------------------------------------------------------
+static void report(const Options &options, const StageStats *stages, size_t frames, double wallTime, FrameFeed &feed,
+        const SheetStats &sheet, const vector<ResolutionStats> &resolutions, const OscStats &osc) {
+    double fps = wallTime > 0 ? frames / (wallTime / 1e6) : 0;
+    string source = feed.getName();
+    int width = feed.getWidth();
+    int height = feed.getHeight();
+    double filter = stages[HAND_FILTER].percentile(0.5);
+    double speedup = filter > 0 ? stages[HAND_FILTER_OPENCV].percentile(0.5) / filter : 0;
+    double oscSpeedup = osc.ofxOscRate > 0 ? osc.rate / osc.ofxOscRate : 0;
+    double sheetDetect = sheet.detect.percentile(0.5);
+    double sheetSpeedup = sheetDetect > 0 ? sheet.legacy.percentile(0.5) / sheetDetect : 0;
+    size_t sheetPasses = sheet.detect.times.size();
+
+    if (options.format == "json") {
+        printf("{\n");
+        printf("  \"allocs_counted\": \"%s\",\n", allocationsCounted);
+        printf("  \"source\": \"%s\",\n", source.c_str());
+        printf("  \"width\": %d,\n  \"height\": %d,\n", width, height);
+        printf("  \"frames\": %lu,\n", (unsigned long) frames);
+        printf("  \"fps\": %.2f,\n", fps);
+        printf("  \"morphology_speedup\": %.2f,\n", speedup);
+        printf("  \"sheet_width\": %d,\n  \"sheet_height\": %d,\n", sheet.width, sheet.height);
+        printf("  \"sheet_shapes\": %lu,\n", (unsigned long) sheet.shapes);
+        printf("  \"sheet_detect_p50_us\": %.1f,\n", sheetDetect);
+        printf("  \"sheet_detect_legacy_p50_us\": %.1f,\n", sheet.legacy.percentile(0.5));
+        printf("  \"sheet_detect_speedup\": %.2f,\n", sheetSpeedup);
+        printf("  \"resolutions\": [\n");
+        for (size_t i = 0; i < resolutions.size(); i++) {
+            const ResolutionStats &res = resolutions[i];
+            printf("    {\"width\": %d, \"height\": %d, \"pyramid_p50_us\": %.1f, \"full_p50_us\": %.1f, "
+                    "\"pyramid_controls\": %lu, \"full_controls\": %lu}%s\n",
+                    res.width, res.height, res.pyramid.percentile(0.5), res.full.percentile(0.5),
+                    (unsigned long) res.pyramidShapes, (unsigned long) res.fullShapes,
+                    i + 1 < resolutions.size() ? "," : "");
+        }
+        printf("  ],\n");
+        printf("  \"osc_msgs_per_s\": %.0f,\n", osc.rate);
+        printf("  \"osc_ofxosc_msgs_per_s\": %.0f,\n", osc.ofxOscRate);
+        printf("  \"osc_speedup\": %.2f,\n", oscSpeedup);
+        printf("  \"osc_allocs_per_msg\": %.2f,\n", osc.allocations);
+        printf("  \"osc_ofxosc_allocs_per_msg\": %.2f,\n", osc.ofxOscAllocations);
+        printf("  \"stages\": [\n");
+        for (int s = 0; s < NUM_STAGES; s++) {
+            const StageStats &st = stages[s];
+            printf("    {\"name\": \"%s\", \"p50_us\": %.1f, \"p95_us\": %.1f, \"p99_us\": %.1f, "
+                    "\"mean_us\": %.1f, \"allocs_per_frame\": %.2f}%s\n",
+                    stageNames[s], st.percentile(0.5), st.percentile(0.95), st.percentile(0.99),
+                    st.mean(), (double) st.allocations / max((size_t) 1, frames),
+                    s + 1 < NUM_STAGES ? "," : "");
+        }
+        printf("  ]\n}\n");
+    } else if (options.format == "csv") {
+        printf("stage,p50_us,p95_us,p99_us,mean_us,allocs_per_frame\n");
+        for (int s = 0; s < NUM_STAGES; s++) {
+            const StageStats &st = stages[s];
+            printf("%s,%.1f,%.1f,%.1f,%.1f,%.2f\n", stageNames[s],
+                    st.percentile(0.5), st.percentile(0.95), st.percentile(0.99),
+                    st.mean(), (double) st.allocations / max((size_t) 1, frames));
+        }
+        printf("total,,,,%.1f,\n", frames > 0 ? wallTime / frames : 0);
+        printf("sheet.detect,%.1f,%.1f,%.1f,%.1f,%.2f\n", sheetDetect,
+                sheet.detect.percentile(0.95), sheet.detect.percentile(0.99), sheet.detect.mean(),
+                (double) sheet.detect.allocations / max((size_t) 1, sheetPasses));
+        printf("sheet.detect.legacy,%.1f,%.1f,%.1f,%.1f,%.2f\n", sheet.legacy.percentile(0.5),
+                sheet.legacy.percentile(0.95), sheet.legacy.percentile(0.99), sheet.legacy.mean(),
+                (double) sheet.legacy.allocations / max((size_t) 1, sheetPasses));
+        for (size_t i = 0; i < resolutions.size(); i++) {
+            const ResolutionStats &res = resolutions[i];
+            const StageStats *modes[2] = { &res.pyramid, &res.full };
+            const char *names[2] = { "pyramid", "full" };
+            for (int m = 0; m < 2; m++) {
+                const StageStats &st = *modes[m];
+                printf("unwarp.%d.%s,%.1f,%.1f,%.1f,%.1f,%.2f\n", res.width, names[m],
+                        st.percentile(0.5), st.percentile(0.95), st.percentile(0.99), st.mean(),
+                        (double) st.allocations / max((size_t) 1, st.times.size()));
+            }
+        }
+        printf("osc.encode,,,,%.3f,\n", osc.rate > 0 ? 1e6 / osc.rate : 0);
+        printf("osc.encode.ofxosc,,,,%.3f,\n", osc.ofxOscRate > 0 ? 1e6 / osc.ofxOscRate : 0);
+    } else {
+        printf("%s, %dx%d, %lu frames, %.1f frames/s, allocations counted: %s\n\n",
+                source.c_str(), width, height, (unsigned long) frames, fps, allocationsCounted);
+        printf("%-20s %10s %10s %10s %10s %12s\n", "stage", "p50 us", "p95 us", "p99 us", "mean us", "allocs/frame");
+        for (int s = 0; s < NUM_STAGES; s++) {
+            const StageStats &st = stages[s];
+            printf("%-20s %10.1f %10.1f %10.1f %10.1f %12.2f\n", stageNames[s],
+                    st.percentile(0.5), st.percentile(0.95), st.percentile(0.99),
+                    st.mean(), (double) st.allocations / max((size_t) 1, frames));
+        }
+        printf("\nmorphology %.1fx faster than OpenCV\n", speedup);
+        printf("%dx%d sheet with %lu controls: detect %.1f us, legacy %.1f us, %.1fx faster\n",
+                sheet.width, sheet.height, (unsigned long) sheet.shapes, sheetDetect, sheet.legacy.percentile(0.5),
+                sheetSpeedup);
+        for (size_t i = 0; i < resolutions.size(); i++) {
+            const ResolutionStats &res = resolutions[i];
+            printf("%dx%d unwarped: pyramid %.1f us (%lu controls), full %.1f us (%lu controls)\n",
+                    res.width, res.height, res.pyramid.percentile(0.5), (unsigned long) res.pyramidShapes,
+                    res.full.percentile(0.5), (unsigned long) res.fullShapes);
+        }
+        printf("osc encoder %.0f msgs/s (%.2f allocs/msg), ofxOsc %.0f msgs/s (%.2f allocs/msg), %.1fx faster\n",
+                osc.rate, osc.allocations, osc.ofxOscRate, osc.ofxOscAllocations, oscSpeedup);
+    }
+}
+
+//---------------------------------------------------------
+// Runs the top camera's stages over every frame, the way the vision thread
+// does, and returns the wall time taken by the recorded ones
+static double benchmarkFrames(const Options &options, FrameFeed &feed, StageStats *stages) {
+    // Same configuration as the app
+    PaperDetector paperDetector;
+    paperDetector.setup();
+    paperDetector.setTracking(true);
+    HandDetector handDetector;
+    ControlManager controlManager;
+    controlManager.setup();
+
+    Settings settings;
+    cv::Rect handRegion;
+
+    BackgroundModel background;
+    background.setLearningTime(1800);
+    background.setThresholdValue(40);
+    background.setMaxHold(300);
+
+    // The three channel float model it replaced, for comparison
+    ofxCv::RunningBackground runningBackground;
+    runningBackground.setLearningTime(1800);
+    runningBackground.setThresholdValue(40);
+    runningBackground.setDifferenceMode(ofxCv::RunningBackground::ABSDIFF);
+
+    Mat unwarped = Mat::zeros(400, 518, CV_8UC3);
+    Mat channel, foreground, runningForeground;
+    int fromTo[] = { 1,0 , 1,1 , 1,2 };
+
+    // What HandDetector::filter() used to do
+    Mat elem2x2 = Mat::ones(2, 2, CV_8U);
+    Mat elem3x3 = Mat::ones(3, 3, CV_8U);
+    Mat reference;
+
+    for (int s = 0; s < NUM_STAGES; s++) {
+        stages[s].times.reserve(options.frames);
+    }
+
+    const size_t total = options.warmup + options.frames;
+    double wallStart = 0;
+    bool foundPaper = false;
+
+    for (size_t i = 0; i < total; i++) {
+        Mat frame = feed.next();
+
+        bool record = i >= options.warmup;
+        if (i == options.warmup) {
+            wallStart = now();
+        }
+        countAllocations = record;
+
+        {
+            StageTimer t(stages[PAPER_DETECT], record);
+            foundPaper = paperDetector.detect(frame) || foundPaper;
+        }
+        if (foundPaper) {
+            StageTimer t(stages[PAPER_UNWARP], record);
+            paperDetector.unwarp(unwarped);
+        }
+        {
+            StageTimer t(stages[CONTROL_DETECT], record);
+            controlManager.reset();
+            controlManager.detect(unwarped);
+        }
+        {
+            StageTimer t(stages[BACKGROUND], record);
+            cv::Rect region(0, 0, frame.cols, frame.rows);
+            if (foundPaper) {
+                region = VisionPipeline::getHandRegion(paperDetector.getQuad(), settings.handMargin, frame.size(), handRegion);
+            }
+            if (region != handRegion) {
+                handRegion = region;
+                runningBackground.reset();
+            }
+            background.update(frame, handRegion, 1, foreground, handDetector.getHoldMask(12, handRegion));
+        }
+        {
+            StageTimer t(stages[BACKGROUND_OFXCV], record);
+            Mat frameRegion = frame(handRegion);
+            channel.create(frameRegion.rows, frameRegion.cols, CV_8UC3);
+            cv::mixChannels(&frameRegion, 1, &channel, 1, fromTo, 3);
+            runningBackground.update(channel, runningForeground);
+        }
+        {
+            StageTimer t(stages[HAND_FILTER], record);
+            handDetector.filter(foreground);
+        }
+        {
+            StageTimer t(stages[HAND_FILTER_OPENCV], record);
+            cv::dilate(foreground, reference, elem2x2, cv::Point(-1, -1), 2);
+            cv::erode(foreground, reference, elem2x2, cv::Point(-1, -1), 6);
+            cv::dilate(reference, reference, elem3x3, cv::Point(-1, -1), 5);
+            cv::erode(reference, reference, elem2x2, cv::Point(-1, -1), 3);
+        }
+        bool hand;
+        {
+            StageTimer t(stages[HAND_CONTOURS], record);
+            hand = handDetector.findHands(handRegion.tl()) > 0;
+        }
+        if (hand) {
+            StageTimer t(stages[HAND_FINGERS], record);
+            handDetector.findFingers(paperDetector.getPaper());
+        }
+
+        countAllocations = false;
+    }
+    return now() - wallStart;
+}
+
+//---------------------------------------------------------
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    ofSetLogLevel(OF_LOG_WARNING);
+
+    FrameFeed feed;
+    if (!feed.setup(options.replay, options.controls)) {
+        return 1;
+    }
+
+    StageStats stages[NUM_STAGES];
+    double wallTime = benchmarkFrames(options, feed, stages);
+    SheetStats sheet = benchmarkSheet(options.sheetControls, options.sheetPasses);
+    vector<ResolutionStats> resolutions = benchmarkResolutions(options.controls, options.sheetPasses);
+    OscStats osc = benchmarkOsc(options.oscMessages);
+    report(options, stages, options.frames, wallTime, feed, sheet, resolutions, osc);
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Checks that every stage rewritten for speed still does exactly what the
+ * code it replaced did, and exits with an error if any of them doesn't.
+ * The benchmark times the same pairs; this only compares them.
+ *
+ *   sketchSynth_check [--replay <path>] [--frames <n>] [--controls <n>]
+ *                     [--sheet-controls <n>] [--sheet-passes <n>]
+ *                     [--osc-messages <n>]
+ *
+ * Build and run with "make Check".
+ */
+
+#include <cstdio>
+
+#include "ofMain.h"
+
+#include "Equivalence.h"
+#include "FrameFeed.h"
+
+//---------------------------------------------------------
+struct Options {
+    Options()
+        : frames(300)
+        , controls(6)
+        , sheetControls(300)
+        , sheetPasses(2)
+        , oscMessages(200000)
+    {}
+
+    string replay;
+    size_t frames;
+    int controls;
+    int sheetControls;
+    size_t sheetPasses;
+    size_t oscMessages;
+};
+
+static bool parseOptions(int argc, char *argv[], Options &options) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--replay" && hasValue) {
+            options.replay = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = ofToInt(argv[++i]);
+        } else if (arg == "--controls" && hasValue) {
+            options.controls = ofToInt(argv[++i]);
+        } else if (arg == "--sheet-controls" && hasValue) {
+            options.sheetControls = ofToInt(argv[++i]);
+        } else if (arg == "--sheet-passes" && hasValue) {
+            options.sheetPasses = ofToInt(argv[++i]);
+        } else if (arg == "--osc-messages" && hasValue) {
+            options.oscMessages = ofToInt(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--replay <path>] [--frames <n>] [--controls <n>] "
+                    "[--sheet-controls <n>] [--sheet-passes <n>] [--osc-messages <n>]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+//---------------------------------------------------------
+static bool report(const char *name, const Equivalence::Result &result, const char *runs) {
+    printf("%-12s %s, %lu of %lu %s differ\n", name, result.mismatches > 0 ? "FAIL" : "ok",
+            (unsigned long) result.mismatches, (unsigned long) result.runs, runs);
+    return result.mismatches == 0;
+}
+
+//---------------------------------------------------------
+int main(int argc, char *argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+    ofSetLogLevel(OF_LOG_WARNING);
+
+    // Each check starts from the first frame, with a feed of its own
+    FrameFeed morphologyFeed, backgroundFeed;
+    if (!morphologyFeed.setup(options.replay, options.controls)
+            || !backgroundFeed.setup(options.replay, options.controls)) {
+        return 1;
+    }
+    printf("%s, %dx%d\n\n", morphologyFeed.getName().c_str(), morphologyFeed.getWidth(), morphologyFeed.getHeight());
+
+    bool ok = true;
+    ok = report("morphology", Equivalence::morphology(morphologyFeed, options.frames), "frames") && ok;
+    ok = report("background", Equivalence::background(backgroundFeed, options.frames, 0.001), "frames") && ok;
+    ok = report("controls", Equivalence::controls(options.sheetControls, options.sheetPasses), "passes") && ok;
+    ok = report("osc", Equivalence::osc(options.oscMessages), "messages and bundles") && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,97 @@
+#include "DetectorBenchmark.h"
+
+using cv::Mat;
+using cv::RotatedRect;
+
+namespace DetectorBenchmark {
+
+static const int BORDER = 8;
+
+//---------------------------------------------------------
+LegacyDetector::LegacyDetector() {
+    finder.setMinAreaRadius(20);
+    finder.setMaxAreaRadius(120);
+    finder.setAutoThreshold(false);
+}
+
+//---------------------------------------------------------
+void LegacyDetector::detect(const Mat &img, vector<ControlShape> &shapes) {
+    ofxCv::convertColor(img, grayImg, CV_RGB2GRAY);
+    cv::Canny(grayImg, edgesInput, 160, 180, 3);
+    cv::dilate(edgesInput, edgesInput, Mat::ones(2, 2, CV_8U), cv::Point(-1, -1), 7);
+    cv::erode(edgesInput, edgesInput, Mat::ones(2, 2, CV_8U), cv::Point(-1, -1), 5);
+
+    const cv::Rect &roi = cv::Rect(BORDER, BORDER, edgesInput.cols - 2*BORDER, edgesInput.rows - 2*BORDER);
+    edgesInput(roi).copyTo(edges);
+
+    finder.findContours(edges);
+
+    shapes.clear();
+    size_t n = finder.size();
+    for (size_t i = 0; i < n; i++) {
+        ControlShape shape;
+        if (isButton(i)) {
+            float radius;
+            cv::Point center = finder.getMinEnclosingCircle(i, radius);
+            shape.type = MOMENTARY;
+            shape.rect = RotatedRect(center, cv::Size2f(2 * radius, 2 * radius), 0);
+        } else if (isSlider(i)) {
+            shape.type = CONTINUOUS;
+            shape.rect = finder.getMinAreaRect(i);
+        } else if (isSwitch(i)) {
+            shape.type = TOGGLE;
+            shape.rect = finder.getMinAreaRect(i);
+        } else {
+            continue;
+        }
+        shapes.push_back(shape);
+    }
+}
+
+//---------------------------------------------------------
+bool LegacyDetector::isButton(size_t i) {
+    float radius;
+    finder.getMinEnclosingCircle(i, radius);
+
+    float circleArea = PI * radius * radius;
+    double contourArea = finder.getContourArea(i);
+    return abs(1.0 - circleArea / contourArea) < 0.3;
+}
+
+//---------------------------------------------------------
+bool LegacyDetector::isSlider(size_t i) {
+    float radius;
+    finder.getMinEnclosingCircle(i, radius);
+    float circleArea = PI * radius * radius;
+    double contourArea = finder.getContourArea(i);
+
+    return circleArea / contourArea > 12;
+}
+
+//---------------------------------------------------------
+bool LegacyDetector::isSwitch(size_t i) {
+    RotatedRect rr = finder.getMinAreaRect(i);
+    float rectArea = rr.size.width * rr.size.height;
+
+    double contourArea = finder.getContourArea(i);
+    return abs(1.0 - rectArea / contourArea) < 0.25
+        && abs(1.0 - (float) rr.size.width / rr.size.height) > 0.1;
+}
+
+//---------------------------------------------------------
+bool sameShapes(const vector<ControlShape> &a, const vector<ControlShape> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        const RotatedRect &ra = a[i].rect;
+        const RotatedRect &rb = b[i].rect;
+        if (a[i].type != b[i].type || ra.center != rb.center
+                || ra.size != rb.size || ra.angle != rb.angle) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "Control.h"
+
+/*
+ * Control detection the way it was before ControlDetector measured each
+ * contour once: every classifier asks the contour finder for the areas,
+ * circles and rectangles it needs, one contour at a time. Detection on
+ * dense sheets is timed against it and checked to find the same shapes.
+ */
+namespace DetectorBenchmark {
+    class LegacyDetector {
+    public:
+        LegacyDetector();
+
+        void detect(const cv::Mat &img, vector<ControlShape> &shapes);
+
+    private:
+        bool isButton(size_t i);
+        bool isSlider(size_t i);
+        bool isSwitch(size_t i);
+
+        ofxCv::ContourFinder finder;
+
+        cv::Mat grayImg;
+        cv::Mat edgesInput;
+        cv::Mat edges;
+    };
+
+    // Exactly the same shapes, in the same order
+    bool sameShapes(const vector<ControlShape> &a, const vector<ControlShape> &b);
+}
@@ -0,0 +1,143 @@
+#include <cstring>
+
+#include "BackgroundModel.h"
+#include "ControlDetector.h"
+#include "HandDetector.h"
+
+#include "DetectorBenchmark.h"
+#include "Equivalence.h"
+#include "OscBenchmark.h"
+#include "SyntheticScene.h"
+
+using cv::Mat;
+
+namespace Equivalence {
+
+//---------------------------------------------------------
+Result morphology(FrameFeed &feed, size_t frames) {
+    Result result;
+
+    // Same background settings as the app, so the foreground has hands in
+    // it like the real thing
+    BackgroundModel background;
+    background.setLearningTime(1800);
+    background.setThresholdValue(40);
+    HandDetector handDetector;
+
+    // What HandDetector::filter() used to do
+    Mat elem2x2 = Mat::ones(2, 2, CV_8U);
+    Mat elem3x3 = Mat::ones(3, 3, CV_8U);
+    Mat foreground, reference;
+
+    for (size_t i = 0; i < frames; i++) {
+        background.update(feed.next(), 1, foreground);
+        handDetector.filter(foreground);
+
+        cv::dilate(foreground, reference, elem2x2, cv::Point(-1, -1), 2);
+        cv::erode(foreground, reference, elem2x2, cv::Point(-1, -1), 6);
+        cv::dilate(reference, reference, elem3x3, cv::Point(-1, -1), 5);
+        cv::erode(reference, reference, elem2x2, cv::Point(-1, -1), 3);
+
+        result.runs++;
+        if (cv::countNonZero(reference != handDetector.getDetectorInput()) > 0) {
+            result.mismatches++;
+        }
+    }
+    return result;
+}
+
+//---------------------------------------------------------
+Result background(FrameFeed &feed, size_t frames, double tolerance) {
+    Result result;
+
+    BackgroundModel model;
+    model.setLearningTime(1800);
+    model.setThresholdValue(40);
+
+    ofxCv::RunningBackground running;
+    running.setLearningTime(1800);
+    running.setThresholdValue(40);
+    running.setDifferenceMode(ofxCv::RunningBackground::ABSDIFF);
+
+    Mat channel, foreground, runningForeground;
+    int fromTo[] = { 1,0 , 1,1 , 1,2 };
+
+    for (size_t i = 0; i < frames; i++) {
+        Mat frame = feed.next();
+        model.update(frame, 1, foreground);
+
+        channel.create(frame.rows, frame.cols, CV_8UC3);
+        cv::mixChannels(&frame, 1, &channel, 1, fromTo, 3);
+        running.update(channel, runningForeground);
+
+        result.runs++;
+        int differ = cv::countNonZero(foreground != runningForeground);
+        if (differ > tolerance * foreground.total()) {
+            result.mismatches++;
+        }
+    }
+    return result;
+}
+
+//---------------------------------------------------------
+Result controls(int controls, size_t passes) {
+    Result result;
+
+    // The benchmark's dense sheet, four times the app's unwarped size, with
+    // thresholds at the sheet's own size the way the old detector has them
+    Mat sheet(400 * 4, 518 * 4, CV_8UC3, cv::Scalar(235, 235, 230));
+    SyntheticScene::drawControls(sheet, controls);
+
+    ControlDetector detector;
+    detector.setLayoutWidth(sheet.cols);
+    detector.setPyramid(false);
+    DetectorBenchmark::LegacyDetector legacy;
+    vector<ControlShape> shapes, legacyShapes;
+
+    // More than one pass, so buffers kept between calls get checked too
+    for (size_t i = 0; i < passes; i++) {
+        detector.detect(sheet, shapes);
+        legacy.detect(sheet, legacyShapes);
+
+        result.runs++;
+        if (!DetectorBenchmark::sameShapes(shapes, legacyShapes)) {
+            result.mismatches++;
+        }
+    }
+    return result;
+}
+
+//---------------------------------------------------------
+Result osc(size_t messages) {
+    Result result;
+    OscEncoder encoder;
+    char buffer[2048];
+
+    for (size_t n = 0; n < messages; n++) {
+        size_t size = OscBenchmark::encode(n, encoder);
+        result.runs++;
+        if (size != OscBenchmark::encodeOfxOsc(n, buffer, sizeof(buffer))
+                || memcmp(encoder.getData(), buffer, size) != 0) {
+            result.mismatches++;
+        }
+    }
+
+    // And whole frames the way the sender batches them: timetagged bundles
+    // of up to 20 messages, with and without a sheet's namespace
+    OscEncoder bundleEncoder;
+    for (size_t n = 0, b = 0; n < messages; b++) {
+        size_t count = min((size_t) (1 + b % 20), messages - n);
+        uint64_t timeTag = 0xe5a1c2d300000000ULL + b * 0x051eb851ULL;
+        const char *ns = b % 2 ? "/paper/3" : "";
+        size_t size = OscBenchmark::encodeBundle(n, count, timeTag, ns, bundleEncoder);
+        result.runs++;
+        if (size != OscBenchmark::encodeBundleOfxOsc(n, count, timeTag, ns, buffer, sizeof(buffer))
+                || memcmp(bundleEncoder.getData(), buffer, size) != 0) {
+            result.mismatches++;
+        }
+        n += count;
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "FrameFeed.h"
+
+/*
+ * Each stage that replaced an older implementation, run next to the old one
+ * on the same input, counting the runs where the two disagree. These are
+ * what "make Check" runs; the benchmark only times the two side by side.
+ */
+namespace Equivalence {
+    struct Result {
+        Result() : runs(0), mismatches(0) {}
+
+        size_t runs;
+        size_t mismatches;
+    };
+
+    // HandDetector's bit-packed morphology against the iterated cv::erode
+    // and cv::dilate it replaced, bit for bit, on each frame's foreground
+    Result morphology(FrameFeed &feed, size_t frames);
+
+    // BackgroundModel against ofxCv::RunningBackground fed three copies of
+    // the green channel. Fixed point rounds a little differently from
+    // float, so a frame only counts if more than tolerance of its pixels
+    // come out different.
+    Result background(FrameFeed &feed, size_t frames, double tolerance);
+
+    // ControlDetector against classifying each contour the way it used to,
+    // on a sheet covered in sketches, for the exact same shapes
+    Result controls(int controls, size_t passes);
+
+    // OscEncoder against building and serializing through ofxOsc, byte for
+    // byte, as single messages and as timetagged bundles
+    Result osc(size_t messages);
+}
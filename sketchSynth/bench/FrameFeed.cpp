@@ -0,0 +1,60 @@
+#include "FrameFeed.h"
+
+//---------------------------------------------------------
+FrameFeed::FrameFeed()
+    : replay(NULL)
+    , scene(NULL)
+    , count(0)
+    , name("synthetic")
+    , width(640)
+    , height(480)
+{
+}
+
+//---------------------------------------------------------
+FrameFeed::~FrameFeed() {
+    delete replay;
+    delete scene;
+}
+
+//---------------------------------------------------------
+bool FrameFeed::setup(const string &path, int controls) {
+    if (path.empty()) {
+        scene = new SyntheticScene(width, height, controls);
+        return true;
+    }
+
+    replay = new ReplayFrameSource(path, false, true);
+    if (!replay->setup()) {
+        return false;
+    }
+    name = path;
+    width = replay->getWidth();
+    height = replay->getHeight();
+    return true;
+}
+
+//---------------------------------------------------------
+cv::Mat FrameFeed::next() {
+    if (replay != NULL) {
+        replay->update();
+        return replay->getFrame();
+    }
+    scene->render(count++, synthetic);
+    return synthetic;
+}
+
+//---------------------------------------------------------
+int FrameFeed::getWidth() {
+    return width;
+}
+
+//---------------------------------------------------------
+int FrameFeed::getHeight() {
+    return height;
+}
+
+//---------------------------------------------------------
+string FrameFeed::getName() {
+    return name;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "FrameSource.h"
+#include "SyntheticScene.h"
+
+/*
+ * The camera frames the benchmark and the checks run on: a recording,
+ * looped, or the synthetic scene when there isn't one.
+ */
+class FrameFeed {
+public:
+    FrameFeed();
+    ~FrameFeed();
+
+    // Replays path, or renders a scene with this many controls if path is
+    // empty
+    bool setup(const string &path, int controls);
+
+    // The next frame, valid until the one after
+    cv::Mat next();
+
+    int getWidth();
+    int getHeight();
+    // The recording's path, or "synthetic"
+    string getName();
+
+private:
+    FrameFeed(const FrameFeed &);
+    FrameFeed& operator=(const FrameFeed &);
+
+    ReplayFrameSource *replay;
+    SyntheticScene *scene;
+    cv::Mat synthetic;
+    size_t count;
+
+    string name;
+    int width;
+    int height;
+};
@@ -0,0 +1,169 @@
+#include "ofxOsc.h"
+#include "OscOutboundPacketStream.h"
+
+#include "OscBenchmark.h"
+
+namespace {
+    enum Kind { COUNT, START, STOP, CONTINUOUS_VALUE, TOGGLE_VALUE, MOMENTARY_VALUE };
+
+    Kind kindOf(size_t n) {
+        if (n % 64 == 0) {
+            return COUNT;
+        }
+        if (n % 64 == 32) {
+            return (n / 64) % 2 ? STOP : START;
+        }
+        switch (n % 4) {
+            case 1:
+                return TOGGLE_VALUE;
+            case 2:
+                return MOMENTARY_VALUE;
+            default:
+                return CONTINUOUS_VALUE;
+        }
+    }
+
+    int idOf(size_t n) {
+        return (n / 4) % 12;
+    }
+
+    float valueOf(size_t n) {
+        return (n % 1001) / 1000.0f;
+    }
+
+    bool stateOf(size_t n) {
+        return (n / 8) % 2;
+    }
+
+    void add(size_t n, OscEncoder &encoder) {
+        switch (kindOf(n)) {
+            case COUNT:
+                encoder.addCount((ControlType) (n / 64 % 3), idOf(n));
+                break;
+            case START:
+                encoder.addStart();
+                break;
+            case STOP:
+                encoder.addStop();
+                break;
+            case CONTINUOUS_VALUE:
+                encoder.addContinuous(idOf(n), valueOf(n));
+                break;
+            case TOGGLE_VALUE:
+                encoder.addToggle(idOf(n), stateOf(n));
+                break;
+            case MOMENTARY_VALUE:
+                encoder.addMomentary(idOf(n), stateOf(n));
+                break;
+        }
+    }
+
+    // The message the old OscSender built for the same call
+    void build(size_t n, const string &ns, ofxOscMessage &m) {
+        switch (kindOf(n)) {
+            case COUNT:
+                m.setAddress(ns + "/count");
+                switch ((ControlType) (n / 64 % 3)) {
+                    case CONTINUOUS:
+                        m.addStringArg("continuous");
+                        break;
+                    case TOGGLE:
+                        m.addStringArg("toggle");
+                        break;
+                    case MOMENTARY:
+                        m.addStringArg("momentary");
+                        break;
+                }
+                m.addIntArg(idOf(n));
+                break;
+            case START:
+                m.setAddress(ns + "/start");
+                break;
+            case STOP:
+                m.setAddress(ns + "/stop");
+                break;
+            case CONTINUOUS_VALUE:
+                m.setAddress(ns + "/continuous");
+                m.addIntArg(idOf(n));
+                m.addFloatArg(valueOf(n));
+                break;
+            case TOGGLE_VALUE:
+                m.setAddress(ns + "/toggle");
+                m.addIntArg(idOf(n));
+                m.addStringArg(stateOf(n) ? "on" : "off");
+                break;
+            case MOMENTARY_VALUE:
+                m.setAddress(ns + "/momentary");
+                m.addIntArg(idOf(n));
+                m.addStringArg(stateOf(n) ? "on" : "off");
+                break;
+        }
+    }
+
+    // What ofxOscSender::appendMessage() does
+    void append(ofxOscMessage &m, osc::OutboundPacketStream &p) {
+        p << osc::BeginMessage(m.getAddress().c_str());
+        for (int i = 0; i < m.getNumArgs(); i++) {
+            switch (m.getArgType(i)) {
+                case OFXOSC_TYPE_INT32:
+                    p << m.getArgAsInt32(i);
+                    break;
+                case OFXOSC_TYPE_FLOAT:
+                    p << m.getArgAsFloat(i);
+                    break;
+                case OFXOSC_TYPE_STRING:
+                    p << m.getArgAsString(i).c_str();
+                    break;
+                default:
+                    break;
+            }
+        }
+        p << osc::EndMessage;
+    }
+}
+
+//---------------------------------------------------------
+size_t OscBenchmark::encode(size_t n, OscEncoder &encoder) {
+    encoder.clear();
+    encoder.beginBundle();
+    add(n, encoder);
+    encoder.endBundle();
+    return encoder.getSize();
+}
+
+//---------------------------------------------------------
+size_t OscBenchmark::encodeOfxOsc(size_t n, char *buffer, size_t capacity) {
+    ofxOscMessage m;
+    build(n, "/paper", m);
+
+    osc::OutboundPacketStream p(buffer, capacity);
+    p << osc::BeginBundleImmediate;
+    append(m, p);
+    p << osc::EndBundle;
+    return p.Size();
+}
+
+//---------------------------------------------------------
+size_t OscBenchmark::encodeBundle(size_t first, size_t count, uint64_t timeTag, const char *ns, OscEncoder &encoder) {
+    encoder.setNamespace(*ns != '\0' ? ns : "/paper");
+    encoder.clear();
+    encoder.beginBundle(timeTag);
+    for (size_t n = first; n < first + count; n++) {
+        add(n, encoder);
+    }
+    encoder.endBundle();
+    return encoder.getSize();
+}
+
+//---------------------------------------------------------
+size_t OscBenchmark::encodeBundleOfxOsc(size_t first, size_t count, uint64_t timeTag, const char *ns, char *buffer, size_t capacity) {
+    osc::OutboundPacketStream p(buffer, capacity);
+    p << osc::BeginBundle(timeTag);
+    for (size_t n = first; n < first + count; n++) {
+        ofxOscMessage m;
+        build(n, *ns != '\0' ? ns : "/paper", m);
+        append(m, p);
+    }
+    p << osc::EndBundle;
+    return p.Size();
+}
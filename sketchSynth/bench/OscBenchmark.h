@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "OscEncoder.h"
+
+/*
+ * The stream of messages the OSC encoder is timed on, mostly slider values
+ * with some button and switch events and the odd control count, start or
+ * stop, encoded
+ * both ways: with OscEncoder, and the way ofxOscSender::sendMessage() did it,
+ * by building an ofxOscMessage and serializing it through oscpack in a
+ * bundle of its own. The socket is left out of both.
+ */
+namespace OscBenchmark {
+    // Message n, written as one immediate bundle. Return the size in bytes.
+    size_t encode(size_t n, OscEncoder &encoder);
+    size_t encodeOfxOsc(size_t n, char *buffer, size_t capacity);
+
+    // Messages first to first + count - 1 together in one bundle with the
+    // given time tag, under the namespace (empty for /paper), the way the
+    // sender batches a frame
+    size_t encodeBundle(size_t first, size_t count, uint64_t timeTag, const char *ns, OscEncoder &encoder);
+    size_t encodeBundleOfxOsc(size_t first, size_t count, uint64_t timeTag, const char *ns, char *buffer, size_t capacity);
+}
@@ -0,0 +1,101 @@
+#include "SyntheticScene.h"
+
+using cv::Mat;
+using cv::Point;
+using cv::Point2f;
+using cv::Scalar;
+
+static const int sheetWidth = 518;
+static const int sheetHeight = 400;
+
+//---------------------------------------------------------
+SyntheticScene::SyntheticScene(int width, int height, int controls)
+    : width(width)
+    , height(height)
+{
+    // A slightly rotated sheet, roughly where it sits on the table
+    float sx = width / 640.0;
+    float sy = height / 480.0;
+    paper.push_back(Point2f(150 * sx, 80 * sy));
+    paper.push_back(Point2f(505 * sx, 95 * sy));
+    paper.push_back(Point2f(490 * sx, 370 * sy));
+    paper.push_back(Point2f(135 * sx, 355 * sy));
+
+    drawSheet(controls);
+
+    noise.create(height, width, CV_8UC3);
+}
+
+//---------------------------------------------------------
+void SyntheticScene::drawSheet(int controls) {
+    Mat sheet(sheetHeight, sheetWidth, CV_8UC3, Scalar(235, 235, 230));
+
+    drawControls(sheet, controls);
+
+    // Put the sheet on a dark table
+    Point2f src[4] = {
+        Point2f(0, 0), Point2f(sheetWidth, 0),
+        Point2f(sheetWidth, sheetHeight), Point2f(0, sheetHeight)
+    };
+    Mat toCamera = cv::getPerspectiveTransform(src, &paper[0]);
+    table = Mat(height, width, CV_8UC3, Scalar(60, 55, 50));
+    cv::warpPerspective(sheet, table, toCamera, table.size(), cv::INTER_LINEAR, cv::BORDER_TRANSPARENT);
+}
+
+//---------------------------------------------------------
+void SyntheticScene::drawControls(Mat &sheet, int controls) {
+    // Lay the controls out on a grid, cycling through buttons, sliders and
+    // switches
+    int cols = max(1, (int) ceil(sqrt(controls * (float) sheet.cols / sheet.rows)));
+    int rows = max(1, (controls + cols - 1) / cols);
+    float cw = (sheet.cols - 40) / (float) cols;
+    float ch = (sheet.rows - 40) / (float) rows;
+    int thickness = max(1, (int) (min(cw, ch) / 25));
+
+    for (int i = 0; i < controls; i++) {
+        Point c(20 + cw * (i % cols + 0.5), 20 + ch * (i / cols + 0.5));
+        int r = min(cw, ch) * 0.3;
+        Scalar ink(20, 20, 30);
+        switch (i % 3) {
+            case 0:
+                cv::circle(sheet, c, r, ink, thickness, CV_AA);
+                break;
+            case 1:
+                cv::line(sheet, Point(c.x - 1.3 * r, c.y), Point(c.x + 1.3 * r, c.y), ink, thickness, CV_AA);
+                cv::line(sheet, Point(c.x - 1.3 * r, c.y - r / 3), Point(c.x - 1.3 * r, c.y + r / 3), ink, thickness, CV_AA);
+                cv::line(sheet, Point(c.x + 1.3 * r, c.y - r / 3), Point(c.x + 1.3 * r, c.y + r / 3), ink, thickness, CV_AA);
+                break;
+            case 2:
+                cv::rectangle(sheet, Point(c.x - r, c.y - r / 2), Point(c.x + r, c.y + r / 2), ink, thickness, CV_AA);
+                break;
+        }
+    }
+}
+
+//---------------------------------------------------------
+void SyntheticScene::render(size_t frame, Mat &out) {
+    table.copyTo(out);
+    if (frame >= emptyFrames) {
+        drawHand(frame, out);
+    }
+
+    // A little sensor noise keeps background subtraction honest
+    cv::randu(noise, Scalar::all(0), Scalar::all(6));
+    out += noise;
+}
+
+//---------------------------------------------------------
+void SyntheticScene::drawHand(size_t frame, Mat &out) {
+    // Sweep the fingertip back and forth across the lower part of the sheet
+    float t = (frame - emptyFrames) * 0.05;
+    Point2f tip(
+        ofLerp(paper[3].x, paper[2].x, 0.5 + 0.35 * sin(t)),
+        ofLerp(paper[0].y, paper[3].y, 0.55 + 0.15 * cos(1.7 * t)));
+    Point2f palm(tip.x + 20, height + 30);
+
+    Scalar skin(205, 160, 130);
+    int fingerWidth = max(8, width / 40);
+    cv::line(out, tip, Point2f(ofLerp(tip.x, palm.x, 0.6), ofLerp(tip.y, palm.y, 0.6)), skin, fingerWidth, CV_AA);
+    cv::ellipse(out, palm, cv::Size(width / 9, height / 4), 0, 0, 360, skin, -1, CV_AA);
+    cv::circle(out, tip, fingerWidth / 2, skin, -1, CV_AA);
+}
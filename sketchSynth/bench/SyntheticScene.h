@@ -0,0 +1,32 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+/*
+ * Renders camera frames of a sheet of sketched controls on a table, with a
+ * hand reaching in from the bottom and moving its finger over the sheet. The
+ * first few frames are empty so background subtraction has something to learn.
+ */
+class SyntheticScene {
+public:
+    SyntheticScene(int width = 640, int height = 480, int controls = 6);
+
+    void render(size_t frame, cv::Mat &out);
+
+    // Sketches controls on a grid over a blank sheet of any size
+    static void drawControls(cv::Mat &sheet, int controls);
+
+    static const size_t emptyFrames = 5;
+
+private:
+    void drawSheet(int controls);
+    void drawHand(size_t frame, cv::Mat &out);
+
+    int width;
+    int height;
+
+    cv::Mat table;
+    cv::Mat noise;
+    vector<cv::Point2f> paper;
+};
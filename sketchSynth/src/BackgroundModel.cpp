@@ -0,0 +1,207 @@
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+
+#include "BackgroundModel.h"
+
+using cv::Mat;
+
+//---------------------------------------------------------
+BackgroundModel::BackgroundModel()
+    : learningTime(900)
+    , threshold(26)
+    , maxHold(0)
+    , needsReset(true)
+{
+    updateRate();
+}
+
+//---------------------------------------------------------
+void BackgroundModel::setLearningTime(float frames) {
+    learningTime = frames;
+    updateRate();
+}
+
+//---------------------------------------------------------
+void BackgroundModel::setThresholdValue(int value) {
+    threshold = value;
+    updateRate();
+}
+
+//---------------------------------------------------------
+void BackgroundModel::setMaxHold(int frames) {
+    maxHold = max(frames, 0);
+}
+
+//---------------------------------------------------------
+void BackgroundModel::updateRate() {
+    // A change of exactly the threshold takes learningTime frames to fade
+    // into the background, which is what RunningBackground does
+    double r = 1 - pow(1 - threshold / 255.0, 1.0 / learningTime);
+    rate = (int64_t) (r * (1 << 24) + 0.5);
+}
+
+//---------------------------------------------------------
+void BackgroundModel::reset() {
+    needsReset = true;
+}
+
+//---------------------------------------------------------
+const Mat& BackgroundModel::getBackground() {
+    return background;
+}
+
+//---------------------------------------------------------
+void BackgroundModel::update(const Mat &frame, int channel, Mat &foreground, const Mat &hold) {
+    update(frame, cv::Rect(0, 0, frame.cols, frame.rows), channel, foreground, hold);
+}
+
+//---------------------------------------------------------
+void BackgroundModel::update(const Mat &frame, const cv::Rect &region, int channel, Mat &foreground, const Mat &hold) {
+    extractChannel(frame(region), channel);
+
+    const int rows = plane.rows;
+    const int cols = plane.cols;
+    foreground.create(rows, cols, CV_8UC1);
+
+    if (needsReset || model.size() != frame.size()) {
+        needsReset = false;
+        model.create(frame.size(), CV_32S);
+        background.create(frame.size(), CV_8UC1);
+        held = Mat::zeros(frame.size(), CV_16UC1);
+        modelled = cv::Rect();
+    }
+    // Newly seeded pixels match the frame, so they come out as background
+    seed(region);
+
+    for (int y = 0; y < rows; y++) {
+        const uchar *p = plane.ptr<uchar>(y);
+        const uchar *b = background.ptr<uchar>(region.y + y) + region.x;
+        uchar *f = foreground.ptr<uchar>(y);
+
+        int x = 0;
+#ifdef __SSE2__
+        // |p - b| > threshold, 16 pixels at a time
+        const __m128i t = _mm_set1_epi8((char) min(max(threshold, 0), 255));
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= cols; x += 16) {
+            __m128i vp = _mm_loadu_si128((const __m128i *) (p + x));
+            __m128i vb = _mm_loadu_si128((const __m128i *) (b + x));
+            __m128i diff = _mm_or_si128(_mm_subs_epu8(vp, vb), _mm_subs_epu8(vb, vp));
+            __m128i over = _mm_cmpeq_epi8(_mm_subs_epu8(diff, t), zero);
+            _mm_storeu_si128((__m128i *) (f + x), _mm_andnot_si128(over, _mm_set1_epi8((char) 255)));
+        }
+#endif
+        for (; x < cols; x++) {
+            f[x] = abs(p[x] - b[x]) > threshold ? 255 : 0;
+        }
+    }
+
+    learn(region, hold);
+    modelled = region;
+}
+
+//---------------------------------------------------------
+void BackgroundModel::seed(const cv::Rect &region) {
+    const int right = region.x + region.width;
+    for (int y = 0; y < region.height; y++) {
+        const int row = region.y + y;
+
+        // Whatever of this row lies outside what was modelled last time
+        int from[2] = { region.x, right };
+        int to[2] = { right, right };
+        if (row >= modelled.y && row < modelled.y + modelled.height) {
+            to[0] = min(max(modelled.x, region.x), right);
+            from[1] = max(modelled.x + modelled.width, region.x);
+        }
+
+        const uchar *p = plane.ptr<uchar>(y);
+        int32_t *m = model.ptr<int32_t>(row);
+        uchar *b = background.ptr<uchar>(row);
+        uint16_t *n = held.ptr<uint16_t>(row);
+        for (int k = 0; k < 2; k++) {
+            for (int x = from[k]; x < to[k]; x++) {
+                m[x] = (int32_t) p[x - region.x] << 16;
+                b[x] = p[x - region.x];
+                n[x] = 0;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+void BackgroundModel::extractChannel(const Mat &frame, int channel) {
+    const int channels = frame.channels();
+    if (channels == 1) {
+        frame.copyTo(plane);
+        return;
+    }
+
+    plane.create(frame.rows, frame.cols, CV_8UC1);
+    for (int y = 0; y < frame.rows; y++) {
+        const uchar *src = frame.ptr<uchar>(y);
+        uchar *dst = plane.ptr<uchar>(y);
+
+        int x = 0;
+#ifdef __SSSE3__
+        if (channels == 3) {
+            // Gather every third byte of 48 into 16
+            uchar ma[16], mb[16], mc[16];
+            for (int i = 0; i < 16; i++) {
+                int from = channel + 3 * i;
+                ma[i] = from < 16 ? from : 0x80;
+                mb[i] = from >= 16 && from < 32 ? from - 16 : 0x80;
+                mc[i] = from >= 32 ? from - 32 : 0x80;
+            }
+            const __m128i sa = _mm_loadu_si128((const __m128i *) ma);
+            const __m128i sb = _mm_loadu_si128((const __m128i *) mb);
+            const __m128i sc = _mm_loadu_si128((const __m128i *) mc);
+            for (; x + 16 <= frame.cols; x += 16) {
+                const uchar *s = src + 3 * x;
+                __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) s), sa);
+                __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (s + 16)), sb);
+                __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (s + 32)), sc);
+                _mm_storeu_si128((__m128i *) (dst + x), _mm_or_si128(_mm_or_si128(a, b), c));
+            }
+        }
+#endif
+        for (; x < frame.cols; x++) {
+            dst[x] = src[channels * x + channel];
+        }
+    }
+}
+
+//---------------------------------------------------------
+void BackgroundModel::learn(const cv::Rect &region, const Mat &hold) {
+    const bool holding = !hold.empty() && hold.size() == plane.size();
+    const int limit = maxHold > 0 ? min(maxHold, 65535) : 65535;
+
+    for (int y = 0; y < plane.rows; y++) {
+        const uchar *p = plane.ptr<uchar>(y);
+        const uchar *h = holding ? hold.ptr<uchar>(y) : NULL;
+        uint16_t *n = held.ptr<uint16_t>(region.y + y) + region.x;
+        int32_t *m = model.ptr<int32_t>(region.y + y) + region.x;
+        uchar *b = background.ptr<uchar>(region.y + y) + region.x;
+
+        for (int x = 0; x < plane.cols; x++) {
+            // Once a pixel has been held too long it's learned like any
+            // other until the mask lets it go
+            if (h != NULL && h[x]) {
+                if (n[x] < limit) {
+                    n[x]++;
+                }
+                if (maxHold == 0 || n[x] < maxHold) {
+                    continue;
+                }
+            } else {
+                n[x] = 0;
+            }
+            int32_t delta = ((int32_t) p[x] << 16) - m[x];
+            m[x] += (int32_t) ((delta * rate) >> 24);
+            b[x] = (m[x] + 0x8000) >> 16;
+        }
+    }
+}
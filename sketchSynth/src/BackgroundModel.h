@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+/*
+ * A running average background over a single channel of the camera image,
+ * kept in 16.16 fixed point. It learns and thresholds the same way as
+ * ofxCv::RunningBackground in ABSDIFF mode, but reads one channel straight
+ * out of the interleaved frame instead of modelling three copies of it.
+ */
+class BackgroundModel {
+public:
+    BackgroundModel();
+
+    // Same meaning as in ofxCv::RunningBackground
+    void setLearningTime(float frames);
+    void setThresholdValue(int threshold);
+    // Longest a pixel can be held out of the learning, in frames, so
+    // something that stays in a hold mask is learned eventually. 0 holds
+    // for as long as the mask says.
+    void setMaxHold(int frames);
+
+    // The next frame becomes the background
+    void reset();
+
+    // Sets foreground to 255 wherever the chosen channel of frame differs
+    // from the background by more than the threshold, then learns the frame.
+    // Pixels set in hold, if given, are left out of the learning so
+    // something sitting still there isn't absorbed into the background.
+    void update(const cv::Mat &frame, int channel, cv::Mat &foreground, const cv::Mat &hold = cv::Mat());
+    // The same, but only for region of a model the size of the whole frame.
+    // foreground and hold cover just the region. Pixels the region didn't
+    // take in last time start out as whatever this frame has there, and
+    // the rest keep what they had learned.
+    void update(const cv::Mat &frame, const cv::Rect &region, int channel, cv::Mat &foreground, const cv::Mat &hold = cv::Mat());
+
+    const cv::Mat& getBackground();
+
+private:
+    void updateRate();
+    void extractChannel(const cv::Mat &frame, int channel);
+    void seed(const cv::Rect &region);
+    void learn(const cv::Rect &region, const cv::Mat &hold);
+
+    float learningTime;
+    int threshold;
+    int maxHold;
+
+    // Fraction of each new frame mixed into the model, in 8.24 fixed point
+    int64_t rate;
+
+    bool needsReset;
+
+    cv::Mat plane;
+    cv::Mat model;
+    cv::Mat background;
+    // Frames each pixel has been held for in a row
+    cv::Mat held;
+    // What the last update covered
+    cv::Rect modelled;
+};
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "BinaryMorphology.h"
+
+using cv::Mat;
+
+namespace {
+    // 64 bits starting at any bit offset of a packed row
+    inline uint64_t bitsAt(const uint64_t *row, size_t bit) {
+        size_t w = bit >> 6;
+        unsigned r = bit & 63;
+        return r ? (row[w] >> r) | (row[w + 1] << (64 - r)) : row[w];
+    }
+
+    template <bool Erode>
+    inline uint64_t combine(uint64_t a, uint64_t b) {
+        return Erode ? a & b : a | b;
+    }
+
+    // Each byte of entry i is 0xff if bit n of i is set
+    struct ExpandTable {
+        ExpandTable() {
+            for (int i = 0; i < 256; i++) {
+                uint64_t v = 0;
+                for (int b = 0; b < 8; b++) {
+                    if (i & (1 << b)) {
+                        v |= (uint64_t) 0xff << (8 * b);
+                    }
+                }
+                bytes[i] = v;
+            }
+        }
+        uint64_t bytes[256];
+    };
+    const ExpandTable expand;
+}
+
+//---------------------------------------------------------
+void BinaryMorphology::clear() {
+    steps.clear();
+}
+
+//---------------------------------------------------------
+void BinaryMorphology::add(Operation op, cv::Size size, cv::Point anchor) {
+    add(op, size, anchor, 1);
+}
+
+//---------------------------------------------------------
+void BinaryMorphology::add(Operation op, cv::Size size, cv::Point anchor, int iterations) {
+    if (anchor.x < 0) {
+        anchor.x = size.width / 2;
+    }
+    if (anchor.y < 0) {
+        anchor.y = size.height / 2;
+    }
+
+    Step step;
+    step.op = op;
+    step.size = cv::Size(size.width + (iterations - 1) * (size.width - 1),
+                         size.height + (iterations - 1) * (size.height - 1));
+    step.anchor = cv::Point(anchor.x * iterations, anchor.y * iterations);
+    steps.push_back(step);
+}
+
+//---------------------------------------------------------
+const vector<BinaryMorphology::Step>& BinaryMorphology::getSteps() {
+    return steps;
+}
+
+//---------------------------------------------------------
+void BinaryMorphology::apply(const Mat &src, Mat &dst) {
+    CV_Assert(src.type() == CV_8UC1);
+
+    pack(src);
+    for (size_t i = 0; i < steps.size(); i++) {
+        const Step &s = steps[i];
+        if (s.op == ERODE) {
+            horizontal<true>(s.size.width, s.anchor.x);
+            vertical<true>(s.size.height, s.anchor.y);
+        } else {
+            horizontal<false>(s.size.width, s.anchor.x);
+            vertical<false>(s.size.height, s.anchor.y);
+        }
+    }
+    unpack(dst);
+}
+
+//---------------------------------------------------------
+void BinaryMorphology::applyReference(const Mat &src, Mat &dst) {
+    src.copyTo(dst);
+    for (size_t i = 0; i < steps.size(); i++) {
+        const Step &s = steps[i];
+        Mat kernel = Mat::ones(s.size, CV_8U);
+        if (s.op == ERODE) {
+            cv::erode(dst, dst, kernel, s.anchor);
+        } else {
+            cv::dilate(dst, dst, kernel, s.anchor);
+        }
+    }
+}
+
+//---------------------------------------------------------
+void BinaryMorphology::pack(const Mat &src) {
+    cols = src.cols;
+    rows = src.rows;
+    words = (cols + 63) / 64;
+    image.assign((size_t) rows * words, 0);
+
+    for (int y = 0; y < rows; y++) {
+        const uchar *p = src.ptr<uchar>(y);
+        uint64_t *out = &image[(size_t) y * words];
+
+        int x = 0;
+#ifdef __SSE2__
+        const __m128i zero = _mm_setzero_si128();
+        for (; x + 16 <= cols; x += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *) (p + x));
+            uint64_t m = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) & 0xffff;
+            out[x >> 6] |= m << (x & 63);
+        }
+#endif
+        for (; x < cols; x++) {
+            if (p[x]) {
+                out[x >> 6] |= (uint64_t) 1 << (x & 63);
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+void BinaryMorphology::unpack(Mat &dst) {
+    dst.create(rows, cols, CV_8UC1);
+
+    for (int y = 0; y < rows; y++) {
+        uchar *p = dst.ptr<uchar>(y);
+        const uint64_t *in = &image[(size_t) y * words];
+
+        int x = 0;
+        for (; x + 8 <= cols; x += 8) {
+            unsigned b = (in[x >> 6] >> (x & 63)) & 0xff;
+            memcpy(p + x, &expand.bytes[b], 8);
+        }
+        for (; x < cols; x++) {
+            p[x] = (in[x >> 6] >> (x & 63)) & 1 ? 255 : 0;
+        }
+    }
+}
+
+//---------------------------------------------------------
+template <bool Erode>
+void BinaryMorphology::horizontal(int width, int anchor) {
+    if (width == 1 && anchor == 0) {
+        return;
+    }
+
+    // Pixels off either end of the row never change the result, so erosion
+    // pads with ones and dilation with zeros
+    const uint64_t pad = Erode ? ~(uint64_t) 0 : 0;
+    const int guard = anchor / 64 + 1;
+    const int extra = width / 64 + 2;
+    const size_t n = words + extra;
+    padded.assign(guard + n + extra + 2, pad);
+    shifted.resize(n + extra);
+
+    const uint64_t tail = cols % 64 ? ~(uint64_t) 0 << (cols % 64) : 0;
+    for (int y = 0; y < rows; y++) {
+        uint64_t *row = &image[(size_t) y * words];
+        std::copy(row, row + words, padded.begin() + guard);
+        uint64_t &last = padded[guard + words - 1];
+        last = Erode ? last | tail : last & ~tail;
+
+        // shifted[x] starts as the pixel at x - anchor, then each pass
+        // doubles the span it covers, up to [x - anchor, x - anchor + width)
+        const size_t start = (size_t) guard * 64 - anchor;
+        for (size_t j = 0; j < shifted.size(); j++) {
+            shifted[j] = bitsAt(&padded[0], start + 64 * j);
+        }
+
+        int covered = 1;
+        for (; covered * 2 <= width; covered *= 2) {
+            for (size_t j = 0; j < n; j++) {
+                shifted[j] = combine<Erode>(shifted[j], bitsAt(&shifted[0], 64 * j + covered));
+            }
+        }
+        if (covered < width) {
+            for (size_t j = 0; j < n; j++) {
+                shifted[j] = combine<Erode>(shifted[j], bitsAt(&shifted[0], 64 * j + width - covered));
+            }
+        }
+
+        std::copy(shifted.begin(), shifted.begin() + words, row);
+    }
+}
+
+//---------------------------------------------------------
+template <bool Erode>
+void BinaryMorphology::vertical(int height, int anchor) {
+    if (height == 1 && anchor == 0) {
+        return;
+    }
+
+    // Row i of the column buffer is image row i - anchor, with padding rows
+    // above and below
+    const uint64_t pad = Erode ? ~(uint64_t) 0 : 0;
+    const int total = rows + 2 * height;
+    columns.assign((size_t) total * words, pad);
+    std::copy(image.begin(), image.end(), columns.begin() + (size_t) anchor * words);
+
+    int covered = 1;
+    for (; covered * 2 <= height; covered *= 2) {
+        const size_t end = (size_t) (total - covered) * words;
+        const size_t offset = (size_t) covered * words;
+        for (size_t i = 0; i < end; i++) {
+            columns[i] = combine<Erode>(columns[i], columns[i + offset]);
+        }
+    }
+    if (covered < height) {
+        const size_t offset = (size_t) (height - covered) * words;
+        const size_t end = (size_t) rows * words;
+        for (size_t i = 0; i < end; i++) {
+            columns[i] = combine<Erode>(columns[i], columns[i + offset]);
+        }
+    }
+
+    std::copy(columns.begin(), columns.begin() + image.size(), image.begin());
+}
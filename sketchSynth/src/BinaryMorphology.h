@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+/*
+ * Erosion and dilation of binary masks with rectangular kernels. The mask is
+ * packed to one bit per pixel, every step of the recipe runs on the packed
+ * rows, and it is only unpacked at the end. The rectangles are separable, and
+ * each direction takes log2(size) shift-and-combine passes, so even large
+ * kernels are cheap.
+ *
+ * The output matches cv::erode and cv::dilate with all-ones kernels and the
+ * default border, as long as the input is a mask (every pixel 0 or 255).
+ */
+class BinaryMorphology {
+public:
+    enum Operation { ERODE, DILATE };
+
+    struct Step {
+        Operation op;
+        cv::Size size;
+        cv::Point anchor;
+    };
+
+    void clear();
+
+    // An anchor of (-1, -1) means the kernel center, like OpenCV
+    void add(Operation op, cv::Size size, cv::Point anchor = cv::Point(-1, -1));
+
+    // Repeating a rectangular kernel is the same as one larger kernel, which
+    // is how OpenCV handles iterations too
+    void add(Operation op, cv::Size size, cv::Point anchor, int iterations);
+
+    const vector<Step>& getSteps();
+
+    // src is CV_8UC1, and anything nonzero counts as set. dst is 0 or 255.
+    void apply(const cv::Mat &src, cv::Mat &dst);
+
+    // The same recipe through cv::erode and cv::dilate
+    void applyReference(const cv::Mat &src, cv::Mat &dst);
+
+private:
+    void pack(const cv::Mat &src);
+    void unpack(cv::Mat &dst);
+
+    template <bool Erode>
+    void horizontal(int width, int anchor);
+    template <bool Erode>
+    void vertical(int height, int anchor);
+
+    vector<Step> steps;
+
+    int cols;
+    int rows;
+    int words;
+
+    // Packed image, words per row, bit x of a row is pixel x
+    vector<uint64_t> image;
+
+    // Scratch space for the passes, kept between frames
+    vector<uint64_t> padded;
+    vector<uint64_t> shifted;
+    vector<uint64_t> columns;
+};
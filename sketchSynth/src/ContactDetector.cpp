@@ -0,0 +1,72 @@
+#include "ContactDetector.h"
+
+using cv::Mat;
+
+//---------------------------------------------------------
+ContactDetector::ContactDetector()
+    : surface(0)
+    , band(6)
+    , minWidth(4)
+{
+    background.setLearningTime(900);
+    background.setThresholdValue(30);
+}
+
+//---------------------------------------------------------
+void ContactDetector::setSurface(int row, int rows) {
+    if (row != surface || rows != band) {
+        background.reset();
+    }
+    surface = row;
+    band = max(rows, 1);
+}
+
+//---------------------------------------------------------
+void ContactDetector::setMinWidth(int pixels) {
+    minWidth = max(pixels, 1);
+}
+
+//---------------------------------------------------------
+void ContactDetector::reset() {
+    background.reset();
+}
+
+//---------------------------------------------------------
+void ContactDetector::detect(const Mat &frame) {
+    contacts.clear();
+
+    int top = max(surface - band, 0);
+    int bottom = min(surface, frame.rows);
+    if (bottom <= top) {
+        return;
+    }
+    background.update(frame.rowRange(top, bottom), 1, foreground);
+
+    // A column is touched if at least half of the band is foreground there.
+    // The sentinel at the end closes a run that reaches the right edge.
+    cv::reduce(foreground, profile, 0, CV_REDUCE_SUM, CV_32S);
+    const int *sums = profile.ptr<int>(0);
+    const int needed = 255 * ((bottom - top + 1) / 2);
+    int start = -1;
+    for (int x = 0; x <= profile.cols; x++) {
+        bool set = x < profile.cols && sums[x] >= needed;
+        if (set && start < 0) {
+            start = x;
+        } else if (!set && start >= 0) {
+            if (x - start >= minWidth) {
+                contacts.push_back((start + x - 1) / 2.0f);
+            }
+            start = -1;
+        }
+    }
+}
+
+//---------------------------------------------------------
+const vector<float>& ContactDetector::getContacts() {
+    return contacts;
+}
+
+//---------------------------------------------------------
+const Mat& ContactDetector::getForeground() {
+    return foreground;
+}
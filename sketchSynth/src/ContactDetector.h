@@ -0,0 +1,44 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "BackgroundModel.h"
+
+/*
+ * Tells a finger on the paper from one hovering over it, from a camera set
+ * low at the edge of the table and looking across it. The paper's surface
+ * is a row of the side image, and a finger only reaches down into the few
+ * rows just above it when it's touching. Only that band is modelled, and
+ * whatever comes into it is found as runs of foreground columns.
+ */
+class ContactDetector {
+public:
+    ContactDetector();
+
+    // row is where the side camera sees the paper's surface, and band is
+    // how many rows above it count as touching
+    void setSurface(int row, int band);
+    // Narrower runs of foreground are left out as noise
+    void setMinWidth(int pixels);
+
+    // The next frame becomes the background
+    void reset();
+
+    // frame is the whole side camera image
+    void detect(const cv::Mat &frame);
+
+    // The middle of each run, as side image columns, left to right
+    const vector<float>& getContacts();
+    const cv::Mat& getForeground();
+
+private:
+    BackgroundModel background;
+    cv::Mat foreground;
+    cv::Mat profile;
+    vector<float> contacts;
+
+    int surface;
+    int band;
+    int minWidth;
+};
@@ -1,7 +1,28 @@
+#include <algorithm>
 #include <math.h>
 
 #include "Control.h"
 
+namespace {
+    // A line as a quad of two triangles, six vertices
+    ofVec3f* addLine(ofVec3f *v, const ofVec3f &a, const ofVec3f &b, float width) {
+        ofVec3f n(a.y - b.y, b.x - a.x);
+        float length = n.length();
+        if (length > 0) {
+            n *= width / 2 / length;
+        }
+        *v++ = a + n; *v++ = a - n; *v++ = b + n;
+        *v++ = b + n; *v++ = a - n; *v++ = b - n;
+        return v;
+    }
+
+    void fillColor(ofFloatColor *c, int n, const ofColor &color) {
+        if (c != NULL) {
+            std::fill(c, c + n, ofFloatColor(color.r / 255.0, color.g / 255.0, color.b / 255.0, color.a / 255.0));
+        }
+    }
+}
+
 //---------------------------------------------------------
 RectControl::RectControl(const cv::RotatedRect &rotRect, OscSender &sender)
   : Control(sender) {
@@ -15,6 +36,10 @@ RectControl::RectControl(const cv::RotatedRect &rotRect, OscSender &sender)
         rect.setFromCenter(ofxCv::toOf(rotRect.center), s.width, s.height);
         angle = rotRect.angle;
     }
+
+    float a = -angle * DEG_TO_RAD;
+    cosAngle = cos(a);
+    sinAngle = sin(a);
 }
 
 //---------------------------------------------------------
@@ -23,6 +48,15 @@ bool RectControl::contains(float x, float y) {
     return rect.inside(v.x, v.y);
 }
 
+//---------------------------------------------------------
+ofRectangle RectControl::getBounds() {
+    // Half the extent of the rotated rectangle along each axis
+    float hw = (fabs(rect.width * cosAngle) + fabs(rect.height * sinAngle)) / 2;
+    float hh = (fabs(rect.width * sinAngle) + fabs(rect.height * cosAngle)) / 2;
+    ofPoint center = rect.getCenter();
+    return ofRectangle(center.x - hw - 1, center.y - hh - 1, 2 * hw + 2, 2 * hh + 2);
+}
+
 //---------------------------------------------------------
 bool RectControl::operator==(const RectControl &other) {
     // TODO Define constants for thresholds
@@ -36,12 +70,20 @@ bool RectControl::operator==(const RectControl &other) {
 //---------------------------------------------------------
 ofVec2f RectControl::alignPoint(float x, float y) {
     ofPoint center = rect.getCenter();
-    ofVec2f v = ofVec2f(x - center.x, y - center.y);
-    v.rotate(-angle);
+    float dx = x - center.x;
+    float dy = y - center.y;
+    ofVec2f v = ofVec2f(dx * cosAngle - dy * sinAngle, dx * sinAngle + dy * cosAngle);
     v += ofVec2f(rect.x + rect.width / 2, rect.y + rect.height / 2);
     return v;
 }
 
+//---------------------------------------------------------
+ofVec3f RectControl::toPaper(float x, float y) {
+    // The inverse of alignPoint()'s rotation
+    ofPoint center = rect.getCenter();
+    return ofVec3f(center.x + x * cosAngle + y * sinAngle, center.y - x * sinAngle + y * cosAngle);
+}
+
 //---------------------------------------------------------
 Button::Button(float x, float y, float r, OscSender &sender)
   : Control(sender) {
@@ -54,15 +96,53 @@ Button::Button(float x, float y, float r, OscSender &sender)
 }
 
 //---------------------------------------------------------
-void Button::draw() {
-    ofSetColor(color);
-    ofSetLineWidth(5);
-    if (active) {
-        ofFill();
-    } else {
-        ofNoFill();
+Button::Button(const ControlShape &shape, OscSender &sender)
+  : Control(sender) {
+    cx = shape.rect.center.x;
+    cy = shape.rect.center.y;
+
+    radius = shape.rect.size.width / 2;
+    active = false;
+    entered = false;
+    setShape(shape);
+}
+
+//---------------------------------------------------------
+void Button::tessellate(ofVec3f *v, ofFloatColor *c) {
+    // The outline, as a ring of quads
+    float r0 = radius - 2.5;
+    float r1 = radius + 2.5;
+    for (int i = 0; i < segments; i++) {
+        float a0 = TWO_PI * i / segments;
+        float a1 = TWO_PI * (i + 1) / segments;
+        ofVec3f in0(cx + r0 * cos(a0), cy + r0 * sin(a0));
+        ofVec3f out0(cx + r1 * cos(a0), cy + r1 * sin(a0));
+        ofVec3f in1(cx + r0 * cos(a1), cy + r0 * sin(a1));
+        ofVec3f out1(cx + r1 * cos(a1), cy + r1 * sin(a1));
+        *v++ = in0; *v++ = out0; *v++ = out1;
+        *v++ = in0; *v++ = out1; *v++ = in1;
     }
-    ofCircle(cx, cy, radius);
+    fillColor(c, shapeVertices, color);
+}
+
+//---------------------------------------------------------
+void Button::tessellateState(ofVec3f *v, ofFloatColor *c) {
+    // Filled in while it's pressed, and collapsed to nothing otherwise
+    ofVec3f center(cx, cy);
+    float r = active ? radius : 0;
+    for (int i = 0; i < segments; i++) {
+        float a0 = TWO_PI * i / segments;
+        float a1 = TWO_PI * (i + 1) / segments;
+        *v++ = center;
+        *v++ = ofVec3f(cx + r * cos(a0), cy + r * sin(a0));
+        *v++ = ofVec3f(cx + r * cos(a1), cy + r * sin(a1));
+    }
+    fillColor(c, stateVertices, color);
+}
+
+//---------------------------------------------------------
+float Button::getState() {
+    return active ? 1 : 0;
 }
 
 //---------------------------------------------------------
@@ -76,19 +156,33 @@ bool Button::onInteraction(float x, float y) {
         if (!entered) {
             entered = true;
             active = true;
-            sender.sendMomentaryValue(id, active);
+            sender->sendMomentaryValue(id, active);
         }
         return true;
     } else if (entered) {
         active = false;
         entered = false;
-        sender.sendMomentaryValue(id, active);
+        sender->sendMomentaryValue(id, active);
         return true;
     }
 
     return false;
 }
 
+//---------------------------------------------------------
+ofRectangle Button::getBounds() {
+    return ofRectangle(cx - radius - 1, cy - radius - 1, 2 * radius + 2, 2 * radius + 2);
+}
+
+//---------------------------------------------------------
+void Button::release() {
+    if (entered) {
+        active = false;
+        entered = false;
+        sender->sendMomentaryValue(id, active);
+    }
+}
+
 //---------------------------------------------------------
 bool Button::operator==(const Button &other) {
     // TODO Define constants for thresholds
@@ -105,52 +199,70 @@ Slider::Slider(const cv::RotatedRect &rotRect, OscSender &sender)
 }
 
 //---------------------------------------------------------
-void Slider::draw() {
-    ofPushMatrix();
-    ofTranslate(rect.getCenter());
-    ofRotate(angle);
+Slider::Slider(const ControlShape &shape, OscSender &sender)
+  : RectControl(shape.rect, sender) {
+    value = 0;
+    setShape(shape);
+}
 
-    ofNoFill();
-    ofSetLineWidth(4);
-    ofSetColor(color);
+//---------------------------------------------------------
+void Slider::tessellate(ofVec3f *v, ofFloatColor *c) {
+    float w = rect.width;
+    float h = rect.height;
+
+    // The main shape
+    v = addLine(v, toPaper(-w / 2, 0), toPaper(w / 2, 0), 4);
+    v = addLine(v, toPaper(-w / 2, -h / 2), toPaper(-w / 2, h / 2), 4);
+    v = addLine(v, toPaper(w / 2, -h / 2), toPaper(w / 2, h / 2), 4);
 
-    // Draw the main shape
-    ofLine(-rect.width / 2, 0, rect.width / 2, 0);
-    ofLine(-rect.width / 2, -rect.height / 2, -rect.width / 2, rect.height / 2);
-    ofLine(rect.width / 2, -rect.height / 2, rect.width / 2, rect.height / 2);
-    
-    // Draw the tick marks
-    ofSetLineWidth(2);
+    // The tick marks
     for (size_t i = 1; i < 8; i++) {
-        float dx = ((float) i / 8) * rect.width;
-        ofLine(-rect.width / 2 + dx, -rect.height / 3, -rect.width / 2 + dx, rect.height / 3);
+        float dx = ((float) i / 8) * w;
+        v = addLine(v, toPaper(-w / 2 + dx, -h / 3), toPaper(-w / 2 + dx, h / 3), 2);
     }
+    fillColor(c, shapeVertices, color);
+}
 
-    // Draw the value marker
+//---------------------------------------------------------
+void Slider::tessellateState(ofVec3f *v, ofFloatColor *c) {
+    // The value marker, filled with black to hide the ticks under it
     float xval = value * rect.width;
     float knobHeight = 5 * rect.height / 4;
     float knobWidth = rect.width / 8;
-    // Fill the rectangle with black to erase the background
-    ofPushStyle();
-    ofSetColor(0);
-    ofFill();
-    ofRect(-rect.width / 2 + xval - knobWidth / 2, -knobHeight / 2, knobWidth, knobHeight);
-    ofPopStyle();
-
-    ofSetLineWidth(5);
-    ofRect(-rect.width / 2 + xval - knobWidth / 2, -knobHeight / 2, knobWidth, knobHeight);
-    // ofCircle(-rect.width / 2 + xval, 0, 3 * rect.height / 8);
-    
-    ofPopMatrix();
+    float x0 = -rect.width / 2 + xval - knobWidth / 2;
+    float x1 = x0 + knobWidth;
+    float y0 = -knobHeight / 2;
+    float y1 = knobHeight / 2;
+
+    ofVec3f p00 = toPaper(x0, y0);
+    ofVec3f p10 = toPaper(x1, y0);
+    ofVec3f p11 = toPaper(x1, y1);
+    ofVec3f p01 = toPaper(x0, y1);
+    *v++ = p00; *v++ = p10; *v++ = p11;
+    *v++ = p00; *v++ = p11; *v++ = p01;
+
+    v = addLine(v, p00, p10, 5);
+    v = addLine(v, p10, p11, 5);
+    v = addLine(v, p11, p01, 5);
+    v = addLine(v, p01, p00, 5);
+
+    if (c != NULL) {
+        fillColor(c, 6, ofColor(0));
+        fillColor(c + 6, stateVertices - 6, color);
+    }
 }
 
+//---------------------------------------------------------
+float Slider::getState() {
+    return value;
+}
 
 //---------------------------------------------------------
 bool Slider::onInteraction(float x, float y) {
     if (contains(x, y)) {
         ofVec2f v = alignPoint(x, y);
         value = (float) (v.x - rect.x) / rect.width;
-        sender.sendContinuousValue(id, value);
+        sender->sendContinuousValue(id, value);
         return true;
     }
     return false;
@@ -163,25 +275,39 @@ Switch::Switch(const cv::RotatedRect &rotRect, OscSender &sender)
 }
 
 //---------------------------------------------------------
-void Switch::draw() {
-    ofPushMatrix();
-    ofTranslate(rect.getCenter());
-    ofRotate(angle);
-
-    ofNoFill();
-    ofSetLineWidth(3);
-    ofSetColor(color);
+Switch::Switch(const ControlShape &shape, OscSender &sender)
+  : RectControl(shape.rect, sender) {
+    active = false;
+    setShape(shape);
+}
 
-    ofRect(-rect.width / 2, -rect.height / 2, rect.width, rect.height);
-    ofLine(0, -rect.height / 2, 0, rect.height / 2);
+//---------------------------------------------------------
+void Switch::tessellate(ofVec3f *v, ofFloatColor *c) {
+    float w = rect.width;
+    float h = rect.height;
+
+    v = addLine(v, toPaper(-w / 2, -h / 2), toPaper(w / 2, -h / 2), 3);
+    v = addLine(v, toPaper(w / 2, -h / 2), toPaper(w / 2, h / 2), 3);
+    v = addLine(v, toPaper(w / 2, h / 2), toPaper(-w / 2, h / 2), 3);
+    v = addLine(v, toPaper(-w / 2, h / 2), toPaper(-w / 2, -h / 2), 3);
+    v = addLine(v, toPaper(0, -h / 2), toPaper(0, h / 2), 3);
+    fillColor(c, shapeVertices, color);
+}
 
+//---------------------------------------------------------
+void Switch::tessellateState(ofVec3f *v, ofFloatColor *c) {
+    // A cross on whichever half it's set to
+    float h = rect.height;
     float x = (active ? 0 : -rect.width / 2);
-    ofLine(x, -rect.height / 2, x + rect.width / 2, rect.height / 2);
-    ofLine(x + rect.width / 2, -rect.height / 2, x, rect.height / 2);
-
-    ofPopMatrix();
+    v = addLine(v, toPaper(x, -h / 2), toPaper(x + rect.width / 2, h / 2), 3);
+    v = addLine(v, toPaper(x + rect.width / 2, -h / 2), toPaper(x, h / 2), 3);
+    fillColor(c, stateVertices, color);
 }
 
+//---------------------------------------------------------
+float Switch::getState() {
+    return active ? 1 : 0;
+}
 
 //---------------------------------------------------------
 bool Switch::onInteraction(float x, float y) {
@@ -191,7 +317,7 @@ bool Switch::onInteraction(float x, float y) {
 
         if (active != right) {
             active = right;
-            sender.sendToggleValue(id, active);
+            sender->sendToggleValue(id, active);
         }
         return true;
     }
@@ -5,35 +5,63 @@
 
 #include "OscSender.h"
 
-//---------------------------------------------------------
+// A control as it was found on the paper, before it becomes a Control
+struct ControlShape {
+    ControlShape() : type(MOMENTARY), id(-1) {}
+
+    // Sliders are CONTINUOUS, switches TOGGLE and buttons MOMENTARY
+    ControlType type;
+
+    // Buttons are the circle that fits in the rectangle
+    cv::RotatedRect rect;
+
+    // The ID to give the control, if it's free, or -1 for any
+    int id;
+};
+
+/*
+ * Controls are plain values. ControlManager keeps each type in an array of
+ * its own and calls their methods directly, a type at a time, so there's
+ * nothing virtual here; every type has contains(), onInteraction(),
+ * getBounds() and release().
+ *
+ * They don't draw themselves either. Each type writes out the triangles
+ * that draw it for ControlScene: shapeVertices that only change with the
+ * layout, and stateVertices that show how it's set, which only need to be
+ * written again when getState() changes. Lines are quads of the width they
+ * were drawn with.
+ */
 class Control {
 public:
-    Control(OscSender &sender) : id(-1), sender(sender) {}
-    virtual ~Control() {}
+    Control(OscSender &sender) : id(-1), sender(&sender) {}
 
     void setId(int id) {
         this->id = id;
     }
-
-    virtual void draw() = 0;
-    virtual void setColor(const ofColor &newColor) {
-        color = newColor;
+    int getId() {
+        return id;
     }
 
-    virtual bool contains(float x, float y) = 0;
-    virtual bool contains(const ofPoint &point) {
-        return contains(point.x, point.y);
+    // Where the control was found
+    void setShape(const ControlShape &shape) {
+        this->shape = shape;
+    }
+    const ControlShape& getShape() {
+        return shape;
     }
 
-    virtual bool onInteraction(float x, float y) = 0;
-    virtual bool onInteraction(const ofPoint &point) {
-        return onInteraction(point.x, point.y);
+    void setColor(const ofColor &newColor) {
+        color = newColor;
+    }
+    const ofColor& getColor() {
+        return color;
     }
 
 protected:
     int id;
-    OscSender &sender;
+    OscSender *sender;
     ofColor color;
+    ControlShape shape;
 };
 
 //---------------------------------------------------------
@@ -42,7 +70,14 @@ public:
     RectControl(const cv::RotatedRect &rotRect, OscSender &sender);
 
     bool contains(float x, float y);
-    virtual bool operator==(const RectControl &other);
+
+    // Axis aligned box around everything contains() can return true for
+    ofRectangle getBounds();
+
+    // Called when the input that was using the control goes away
+    void release() {}
+
+    bool operator==(const RectControl &other);
     bool operator!=(const RectControl &other) {
         return !(*this == other);
     }
@@ -50,18 +85,36 @@ public:
 protected:
     ofVec2f alignPoint(float x, float y);
 
+    // From the control's own axes, centered on it, to paper coordinates
+    ofVec3f toPaper(float x, float y);
+
     float angle;
     ofRectangle rect;
+
+    // Rotation by -angle, for alignPoint()
+    float cosAngle;
+    float sinAngle;
 };
 
 //---------------------------------------------------------
 class Button : public Control {
 public:
     Button(float x, float y, float r, OscSender &sender);
+    Button(const ControlShape &shape, OscSender &sender);
+
+    // Colors can be NULL to only update positions
+    void tessellate(ofVec3f *vertices, ofFloatColor *colors);
+    void tessellateState(ofVec3f *vertices, ofFloatColor *colors);
+    float getState();
+
+    static const int segments = 48;
+    static const int shapeVertices = 6 * segments;
+    static const int stateVertices = 3 * segments;
 
-    void draw();
     bool contains(float x, float y);
     bool onInteraction(float x, float y);
+    ofRectangle getBounds();
+    void release();
     bool operator==(const Button &other);
     bool operator!=(const Button &other) {
         return !(*this == other);
@@ -79,8 +132,16 @@ private:
 class Slider : public RectControl {
 public:
     Slider(const cv::RotatedRect &rotRect, OscSender &sender);
+    Slider(const ControlShape &shape, OscSender &sender);
+
+    void tessellate(ofVec3f *vertices, ofFloatColor *colors);
+    void tessellateState(ofVec3f *vertices, ofFloatColor *colors);
+    float getState();
+
+    // Three lines and seven ticks, then the knob's fill and outline
+    static const int shapeVertices = 10 * 6;
+    static const int stateVertices = 6 + 4 * 6;
 
-    void draw();
     bool onInteraction(float x, float y);
 
 private:
@@ -91,8 +152,16 @@ private:
 class Switch : public RectControl {
 public:
     Switch(const cv::RotatedRect &rotRect, OscSender &sender);
+    Switch(const ControlShape &shape, OscSender &sender);
+
+    void tessellate(ofVec3f *vertices, ofFloatColor *colors);
+    void tessellateState(ofVec3f *vertices, ofFloatColor *colors);
+    float getState();
+
+    // The box and the line down the middle, then the cross
+    static const int shapeVertices = 5 * 6;
+    static const int stateVertices = 2 * 6;
 
-    void draw();
     bool onInteraction(float x, float y);
 
 private:
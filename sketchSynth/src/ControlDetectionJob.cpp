@@ -0,0 +1,71 @@
+#include "ControlDetectionJob.h"
+
+//---------------------------------------------------------
+ControlDetectionJob::ControlDetectionJob()
+    : state(IDLE)
+    , inputTag(0)
+{
+}
+
+//---------------------------------------------------------
+ControlDetectionJob::~ControlDetectionJob() {
+    stop();
+}
+
+//---------------------------------------------------------
+void ControlDetectionJob::start() {
+    startThread(true, false);
+}
+
+//---------------------------------------------------------
+void ControlDetectionJob::stop() {
+    if (isThreadRunning()) {
+        waitForThread(true);
+    }
+}
+
+//---------------------------------------------------------
+bool ControlDetectionJob::submit(const cv::Mat &unwarped, int tag) {
+    // Only the caller moves the job out of IDLE, so the input is free to
+    // write until it says QUEUED
+    if (state != IDLE) {
+        return false;
+    }
+    unwarped.copyTo(input);
+    inputTag = tag;
+    return transition(IDLE, QUEUED);
+}
+
+//---------------------------------------------------------
+bool ControlDetectionJob::poll(vector<ControlShape> &layout, int &tag) {
+    if (state != DONE) {
+        return false;
+    }
+    __sync_synchronize();
+    layout.swap(output);
+    tag = inputTag;
+    return transition(DONE, IDLE);
+}
+
+//---------------------------------------------------------
+ControlDetector& ControlDetectionJob::getDetector() {
+    return detector;
+}
+
+//---------------------------------------------------------
+void ControlDetectionJob::threadedFunction() {
+    while (isThreadRunning()) {
+        if (!transition(QUEUED, BUSY)) {
+            ofSleepMillis(5);
+            continue;
+        }
+        detector.detect(input, output);
+        transition(BUSY, DONE);
+    }
+}
+
+//---------------------------------------------------------
+bool ControlDetectionJob::transition(State from, State to) {
+    // Full barrier, so everything written before is seen after
+    return __sync_bool_compare_and_swap(&state, from, to);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "ControlDetector.h"
+
+/*
+ * Runs control detection on a thread of its own, one frame at a time, so the
+ * controls can be looked for again during play without holding up
+ * interaction. The caller hands over a frame when the job is idle and picks
+ * up the layout when it's done; neither side ever waits for the other.
+ */
+class ControlDetectionJob : public ofThread {
+public:
+    ControlDetectionJob();
+    ~ControlDetectionJob();
+
+    void start();
+    void stop();
+
+    // Copies the frame and starts on it, unless the job is still busy with
+    // the last one. The tag comes back with the layout.
+    bool submit(const cv::Mat &unwarped, int tag);
+
+    // Takes the finished layout, if there is one
+    bool poll(vector<ControlShape> &layout, int &tag);
+
+    // Only configure it before start()
+    ControlDetector& getDetector();
+
+protected:
+    void threadedFunction();
+
+private:
+    enum State { IDLE, QUEUED, BUSY, DONE };
+
+    bool transition(State from, State to);
+
+    volatile int state;
+
+    ControlDetector detector;
+    cv::Mat input;
+    int inputTag;
+    vector<ControlShape> output;
+};
@@ -0,0 +1,213 @@
+#include "ControlDetector.h"
+
+using cv::Mat;
+using cv::RotatedRect;
+
+//---------------------------------------------------------
+ControlDetector::ControlDetector()
+    : layoutWidth(518)
+    , pyramid(true)
+    , border(BORDER)
+{
+    // Don't threshold, will run edge detection instead
+    finder.setAutoThreshold(false);
+}
+
+//---------------------------------------------------------
+void ControlDetector::setLayoutWidth(int width) {
+    layoutWidth = width;
+}
+
+//---------------------------------------------------------
+void ControlDetector::setPyramid(bool pyramid) {
+    this->pyramid = pyramid;
+}
+
+//---------------------------------------------------------
+void ControlDetector::detect(const Mat &img, vector<ControlShape> &shapes) {
+    float scale = (float) img.cols / layoutWidth;
+
+    // Halve big images until they're about the size of paper coordinates
+    int factor = 1;
+    size_t nLevels = 0;
+    if (pyramid) {
+        while (scale / (2 * factor) >= 0.75) {
+            factor *= 2;
+            nLevels++;
+        }
+    }
+    levels.resize(nLevels);
+    for (size_t l = 0; l < nLevels; l++) {
+        cv::pyrDown(l == 0 ? img : levels[l - 1], levels[l]);
+    }
+
+    findShapes(nLevels == 0 ? img : levels.back(), scale / factor);
+
+    shapes.clear();
+    const int n = finder.size();
+    for (int i = 0; i < n; i++) {
+        if (!isControl[i]) {
+            continue;
+        }
+        ControlShape shape = found[i];
+        cv::Point2f offset(border, border);
+        if (factor > 1) {
+            refine(img, finder.getContour(i), factor, shape);
+            offset = cv::Point2f(0, 0);
+        }
+
+        // Same as always when the image is paper coordinate sized. The
+        // border is left out of paper coordinates at any size.
+        if (img.cols != layoutWidth || factor > 1) {
+            shape.rect.center = (shape.rect.center + offset) * (1 / scale) - cv::Point2f(BORDER, BORDER);
+            shape.rect.size.width /= scale;
+            shape.rect.size.height /= scale;
+        }
+        shapes.push_back(shape);
+    }
+}
+
+//---------------------------------------------------------
+void ControlDetector::findShapes(const Mat &img, float scale) {
+    // Get the image in the right format and run edge detection, closing up
+    // gaps in the lines by the same amount of paper at any size
+    ofxCv::convertColor(img, grayImg, CV_RGB2GRAY);
+    cv::Canny(grayImg, edgesInput, 160, 180, 3);
+    int dilations = max(1, cvRound(7 * scale));
+    int erosions = max(1, cvRound(5 * scale));
+    cv::dilate(edgesInput, edgesInput, Mat::ones(2, 2, CV_8U), cv::Point(-1, -1), dilations);
+    cv::erode(edgesInput, edgesInput, Mat::ones(2, 2, CV_8U), cv::Point(-1, -1), erosions);
+
+    border = cvRound(BORDER * scale);
+    const cv::Rect &roi = cv::Rect(border, border, edgesInput.cols - 2*border, edgesInput.rows - 2*border);
+    edgesInput(roi).copyTo(edges);
+
+    // Find contours in the edge detected image
+    finder.setMinAreaRadius(20 * scale);
+    finder.setMaxAreaRadius(120 * scale);
+    finder.findContours(edges);
+
+    // Contours are independent, so measure and classify them all at once
+    const int n = finder.size();
+    features.resize(n);
+    found.resize(n);
+    isControl.resize(n);
+    #pragma omp parallel for schedule(dynamic, 8)
+    for (int i = 0; i < n; i++) {
+        measure(finder.getContour(i), features[i]);
+        isControl[i] = classify(features[i], found[i]);
+    }
+}
+
+//---------------------------------------------------------
+void ControlDetector::refine(const Mat &img, const vector<cv::Point> &contour, int factor, ControlShape &shape) {
+    // Move the shape onto the full image, in case there's nothing better
+    float half = (factor - 1) / 2.0;
+    shape.rect.center = (shape.rect.center + cv::Point2f(border, border)) * factor + cv::Point2f(half, half);
+    shape.rect.size.width *= factor;
+    shape.rect.size.height *= factor;
+
+    // Where the control was found, on the full image, with a little room
+    cv::Rect box = cv::boundingRect(Mat(contour));
+    box = cv::Rect((box.x + border - 1) * factor, (box.y + border - 1) * factor,
+            (box.width + 2) * factor, (box.height + 2) * factor);
+    box &= cv::Rect(0, 0, img.cols, img.rows);
+    if (box.width <= 0 || box.height <= 0) {
+        return;
+    }
+
+    ofxCv::convertColor(img(box), boxGray, CV_RGB2GRAY);
+    cv::Canny(boxGray, boxEdges, 160, 180, 3);
+
+    // Only the edges inside the outline belong to this control
+    outline.resize(contour.size());
+    for (size_t i = 0; i < contour.size(); i++) {
+        outline[i] = (contour[i] + cv::Point(border, border)) * factor - box.tl();
+    }
+    boxMask.create(box.size(), CV_8U);
+    boxMask.setTo(0);
+    const cv::Point *points = &outline[0];
+    int nPoints = outline.size();
+    cv::fillPoly(boxMask, &points, &nPoints, 1, cv::Scalar(255));
+    cv::dilate(boxMask, boxMask, Mat::ones(3, 3, CV_8U), cv::Point(-1, -1), factor);
+
+    edgePoints.clear();
+    for (int y = 0; y < boxEdges.rows; y++) {
+        const uchar *e = boxEdges.ptr<uchar>(y);
+        const uchar *m = boxMask.ptr<uchar>(y);
+        for (int x = 0; x < boxEdges.cols; x++) {
+            if (e[x] && m[x]) {
+                edgePoints.push_back(cv::Point(box.x + x, box.y + y));
+            }
+        }
+    }
+    if (edgePoints.size() < 5) {
+        return;
+    }
+
+    Mat edgeMat(edgePoints);
+    if (shape.type == MOMENTARY) {
+        cv::Point2f center;
+        float radius;
+        cv::minEnclosingCircle(edgeMat, center, radius);
+        shape.rect = RotatedRect(center, cv::Size2f(2 * radius, 2 * radius), 0);
+    } else {
+        shape.rect = cv::minAreaRect(edgeMat);
+    }
+}
+
+//---------------------------------------------------------
+const Mat& ControlDetector::getInput() {
+    return edges;
+}
+
+//---------------------------------------------------------
+void ControlDetector::measure(const vector<cv::Point> &contour, Features &f) {
+    // The same measurements ofxCv::ContourFinder makes
+    Mat points(contour);
+    f.area = cv::contourArea(points);
+    cv::minEnclosingCircle(points, f.center, f.radius);
+    f.rect = cv::minAreaRect(points);
+}
+
+//---------------------------------------------------------
+bool ControlDetector::classify(const Features &f, ControlShape &shape) {
+    if (isButton(f)) {
+        cv::Point center = f.center;
+        shape.type = MOMENTARY;
+        shape.rect = RotatedRect(center, cv::Size2f(2 * f.radius, 2 * f.radius), 0);
+    } else if (isSlider(f)) {
+        shape.type = CONTINUOUS;
+        shape.rect = f.rect;
+    } else if (isSwitch(f)) {
+        shape.type = TOGGLE;
+        shape.rect = f.rect;
+    } else {
+        return false;
+    }
+    shape.id = -1;
+    return true;
+}
+
+//---------------------------------------------------------
+bool ControlDetector::isButton(const Features &f) {
+    float circleArea = PI * f.radius * f.radius;
+    return abs(1.0 - circleArea / f.area) < 0.3;
+}
+
+//---------------------------------------------------------
+bool ControlDetector::isSlider(const Features &f) {
+    float circleArea = PI * f.radius * f.radius;
+
+    // TODO Possibly consider width/height ratio as well
+    return circleArea / f.area > 12;
+}
+
+//---------------------------------------------------------
+bool ControlDetector::isSwitch(const Features &f) {
+    const RotatedRect &rr = f.rect;
+    float rectArea = rr.size.width * rr.size.height;
+
+    return abs(1.0 - rectArea / f.area) < 0.25
+        && abs(1.0 - (float) rr.size.width / rr.size.height) > 0.1;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "Control.h"
+
+/*
+ * Finds the controls drawn on an unwarped image of the paper. This is the
+ * expensive part of control detection, and has no ties to the controls
+ * themselves, so it can run on any thread as long as each thread has its
+ * own detector.
+ *
+ * Each contour's measurements are taken once, and contours are measured
+ * and classified in parallel when built with OpenMP.
+ *
+ * The thresholds are in paper coordinates, which are layoutWidth pixels
+ * across. Bigger or smaller images are detected with the thresholds scaled
+ * to match, and the shapes always come back in paper coordinates. With the
+ * pyramid on, images much bigger than that are searched at about paper
+ * coordinate size, and each control's outline is then taken from the full
+ * image, but only around where it was found.
+ */
+class ControlDetector {
+public:
+    ControlDetector();
+
+    void setLayoutWidth(int width);
+    void setPyramid(bool pyramid);
+
+    void detect(const cv::Mat &img, vector<ControlShape> &shapes);
+
+    // The edge image from the last detect()
+    const cv::Mat& getInput();
+
+private:
+    // Everything the classifiers look at
+    struct Features {
+        double area;
+        cv::Point2f center;
+        float radius;
+        cv::RotatedRect rect;
+    };
+
+    // Finds controls on img, which is scale times the size of the paper
+    // coordinates, leaving them in the edge image's coordinates
+    void findShapes(const cv::Mat &img, float scale);
+    void refine(const cv::Mat &img, const vector<cv::Point> &contour, int factor, ControlShape &shape);
+
+    static void measure(const vector<cv::Point> &contour, Features &f);
+    static bool classify(const Features &f, ControlShape &shape);
+
+    static bool isButton(const Features &f);
+    static bool isSlider(const Features &f);
+    static bool isSwitch(const Features &f);
+
+    int layoutWidth;
+    bool pyramid;
+
+    ofxCv::ContourFinder finder;
+    vector<Features> features;
+    vector<ControlShape> found;
+    vector<char> isControl;
+    int border;
+
+    vector<cv::Mat> levels;
+    cv::Mat grayImg;
+    cv::Mat edgesInput;
+    cv::Mat edges;
+
+    // Full resolution scratch space for refine()
+    cv::Mat boxGray;
+    cv::Mat boxEdges;
+    cv::Mat boxMask;
+    vector<cv::Point> outline;
+    vector<cv::Point> edgePoints;
+
+    static const int BORDER = 8;
+};
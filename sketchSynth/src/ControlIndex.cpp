@@ -0,0 +1,85 @@
+#include <math.h>
+
+#include "ControlIndex.h"
+
+//---------------------------------------------------------
+ControlIndex::ControlIndex()
+    : cellSize(32)
+    , cols(0)
+    , rows(0)
+{
+}
+
+//---------------------------------------------------------
+void ControlIndex::clear() {
+    cols = rows = 0;
+    cellStart.clear();
+    items.clear();
+}
+
+//---------------------------------------------------------
+void ControlIndex::build(const vector<ofRectangle> &bounds, float size) {
+    clear();
+    if (bounds.empty()) {
+        return;
+    }
+    cellSize = size;
+
+    float x0 = numeric_limits<float>::infinity(), y0 = x0;
+    float x1 = -x0, y1 = -x0;
+    for (size_t i = 0; i < bounds.size(); i++) {
+        const ofRectangle &b = bounds[i];
+        x0 = min(x0, b.x);
+        y0 = min(y0, b.y);
+        x1 = max(x1, b.x + b.width);
+        y1 = max(y1, b.y + b.height);
+    }
+    area.set(x0, y0, x1 - x0, y1 - y0);
+    cols = max(1, (int) ceil(area.width / cellSize));
+    rows = max(1, (int) ceil(area.height / cellSize));
+
+    // Count the controls in each cell, then fill them in, in control order
+    // so queries come out sorted
+    ranges.resize(4 * bounds.size());
+    cellStart.assign(cols * rows + 1, 0);
+    for (size_t i = 0; i < bounds.size(); i++) {
+        const ofRectangle &b = bounds[i];
+        int *r = &ranges[4 * i];
+        r[0] = ofClamp((int) ((b.x - area.x) / cellSize), 0, cols - 1);
+        r[1] = ofClamp((int) ((b.y - area.y) / cellSize), 0, rows - 1);
+        r[2] = ofClamp((int) ((b.x + b.width - area.x) / cellSize), 0, cols - 1);
+        r[3] = ofClamp((int) ((b.y + b.height - area.y) / cellSize), 0, rows - 1);
+        for (int y = r[1]; y <= r[3]; y++) {
+            for (int x = r[0]; x <= r[2]; x++) {
+                cellStart[y * cols + x + 1]++;
+            }
+        }
+    }
+    for (size_t c = 1; c < cellStart.size(); c++) {
+        cellStart[c] += cellStart[c - 1];
+    }
+
+    items.resize(cellStart.back());
+    fill.assign(cellStart.begin(), cellStart.end() - 1);
+    for (size_t i = 0; i < bounds.size(); i++) {
+        const int *r = &ranges[4 * i];
+        for (int y = r[1]; y <= r[3]; y++) {
+            for (int x = r[0]; x <= r[2]; x++) {
+                items[fill[y * cols + x]++] = i;
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+void ControlIndex::query(float x, float y, vector<size_t> &candidates) const {
+    candidates.clear();
+    if (cols == 0 || x < area.x || y < area.y || x > area.x + area.width || y > area.y + area.height) {
+        return;
+    }
+
+    int cx = min((int) ((x - area.x) / cellSize), cols - 1);
+    int cy = min((int) ((y - area.y) / cellSize), rows - 1);
+    size_t c = cy * cols + cx;
+    candidates.insert(candidates.end(), items.begin() + cellStart[c], items.begin() + cellStart[c + 1]);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+
+/*
+ * A uniform grid over the bounding boxes of the controls, so finding the
+ * controls under a point only looks at the few that share its cell. Built
+ * once per detection; cells are stored back to back in one array.
+ */
+class ControlIndex {
+public:
+    ControlIndex();
+
+    // Takes the bounding box of every control, in control order
+    void build(const vector<ofRectangle> &bounds, float cellSize = 32);
+    void clear();
+
+    // Replaces candidates with the indices of the controls whose bounds
+    // might contain (x, y), in ascending order
+    void query(float x, float y, vector<size_t> &candidates) const;
+
+private:
+    ofRectangle area;
+    float cellSize;
+    int cols;
+    int rows;
+
+    // Controls in cell c are items[cellStart[c]] to items[cellStart[c + 1]]
+    vector<size_t> cellStart;
+    vector<size_t> items;
+
+    // Kept between builds so rebuilding doesn't allocate
+    vector<int> ranges;
+    vector<size_t> fill;
+};
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <math.h>
 
 #include "ControlManager.h"
@@ -5,28 +6,61 @@
 using cv::Mat;
 using cv::RotatedRect;
 
+namespace {
+    template <class T>
+    int countIds(vector<T> &controls) {
+        int count = 0;
+        for (size_t i = 0; i < controls.size(); i++) {
+            count = max(count, controls[i].getId() + 1);
+        }
+        return count;
+    }
+
+    template <class T>
+    void addBounds(vector<T> &controls, vector<ofRectangle> &bounds) {
+        for (size_t i = 0; i < controls.size(); i++) {
+            bounds.push_back(controls[i].getBounds());
+        }
+    }
+
+    template <class T>
+    void setColors(vector<T> &controls, const vector<ofColor> &colors) {
+        for (size_t i = 0; i < controls.size(); i++) {
+            controls[i].setColor(colors[controls[i].getId() % colors.size()]);
+        }
+    }
+
+    template <class T>
+    void addShapes(vector<T> &controls, vector<ControlShape> &layout) {
+        for (size_t i = 0; i < controls.size(); i++) {
+            ControlShape shape = controls[i].getShape();
+            shape.id = controls[i].getId();
+            layout.push_back(shape);
+        }
+    }
+}
+
 const ofColor ControlManager::accent1 = ofColor(100, 0, 57);
 const ofColor ControlManager::accent2 = ofColor(45, 0, 180);
 
+//---------------------------------------------------------
+ControlManager::ControlManager()
+    : countsSent(false)
+    , sceneChanged(false)
+{
+}
+
 //---------------------------------------------------------
 ControlManager::~ControlManager() {
-    // Reset will delete all existing control elements
-    reset();
 }
 
 //---------------------------------------------------------
 void ControlManager::setup() {
-	finder.setMinAreaRadius(20);
-	finder.setMaxAreaRadius(120);
-    // Don't threshold, will run edge detection instead
-    finder.setAutoThreshold(false);
-
     sender.setup();
 
     buttons.clear();
     sliders.clear();
     switches.clear();
-    controls.clear();
 
     colors.push_back(ofColor(140, 0, 100));
     colors.push_back(ofColor(87, 0, 210));
@@ -34,104 +68,340 @@ void ControlManager::setup() {
 
 //---------------------------------------------------------
 void ControlManager::reset() {
-    const size_t n = controls.size();
-    for (size_t i = 0; i < n; i++) {
-        if (controls[i] != NULL) {
-            delete controls[i];
-        }
-    }
-
     buttons.clear();
     sliders.clear();
     switches.clear();
-    controls.clear();
+
+    index.clear();
+    owners.clear();
+    controlOwners.clear();
+    layout.clear();
+    scene.clear();
+    sceneChanged = false;
+    countsSent = false;
 }
 
 //---------------------------------------------------------
 void ControlManager::detect(Mat img) {
-    // Get the image in the right format and run edge detection
-    ofxCv::convertColor(img, grayImg, CV_RGB2GRAY);
-    cv::Canny(grayImg, edgesInput, 160, 180, 3);
-    cv::dilate(edgesInput, edgesInput, Mat::ones(2, 2, CV_8U), cv::Point(-1, -1), 7);
-    cv::erode(edgesInput, edgesInput, Mat::ones(2, 2, CV_8U), cv::Point(-1, -1), 5);
+    detector.detect(img, detected);
+    setLayout(detected);
+}
+
+//---------------------------------------------------------
+bool ControlManager::setLayout(const vector<ControlShape> &newLayout) {
+    // Removed controls let go as they're merged away
+    const size_t nButtons = buttons.size();
+    const size_t nSliders = sliders.size();
+    remap.assign(size(), -1);
+
+    bool changed[3];
+    changed[MOMENTARY] = merge(buttons, nextButtons, MOMENTARY, newLayout, remap.begin());
+    changed[CONTINUOUS] = merge(sliders, nextSliders, CONTINUOUS, newLayout, remap.begin() + nButtons);
+    changed[TOGGLE] = merge(switches, nextSwitches, TOGGLE, newLayout, remap.begin() + nButtons + nSliders);
+
+    // The merge numbers controls within their type
+    for (size_t i = nButtons; i < remap.size(); i++) {
+        if (remap[i] >= 0) {
+            remap[i] += (int) (i < nButtons + nSliders ? buttons.size() : buttons.size() + sliders.size());
+        }
+    }
 
-    const cv::Rect &roi = cv::Rect(BORDER, BORDER, edgesInput.cols - 2*BORDER, edgesInput.rows - 2*BORDER);
-    edgesInput(roi).copyTo(edges);
+    bounds.clear();
+    addBounds(buttons, bounds);
+    addBounds(sliders, bounds);
+    addBounds(switches, bounds);
+    index.build(bounds);
+
+    // Touches hold on to the controls that are still here
+    controlOwners.assign(size(), -1);
+    size_t kept = 0;
+    for (size_t i = 0; i < owners.size(); i++) {
+        int c = remap[owners[i].control];
+        if (c >= 0) {
+            owners[kept].touch = owners[i].touch;
+            owners[kept].control = c;
+            controlOwners[c] = owners[kept].touch;
+            kept++;
+        }
+    }
+    owners.resize(kept);
 
-    // Find contours in the edge detected image
-    finder.findContours(edges);
+    setColors(buttons, colors);
+    setColors(sliders, colors);
+    setColors(switches, colors);
 
-    size_t n = finder.size();
+    bool any = changed[MOMENTARY] || changed[CONTINUOUS] || changed[TOGGLE];
+    sceneChanged = sceneChanged || any;
 
-    for (size_t i = 0; i < n; i++) {
-        if (isButton(i)) {
-            float radius;
-            cv::Point center = finder.getMinEnclosingCircle(i, radius);
-            Button *b = new Button(center.x, center.y, radius, sender);
+    // IDs can have gaps after a control is erased, so the count covers the
+    // highest one in use
+    if (changed[MOMENTARY] || !countsSent) {
+        sender.sendControlCount(MOMENTARY, countIds(buttons));
+    }
+    if (changed[CONTINUOUS] || !countsSent) {
+        sender.sendControlCount(CONTINUOUS, countIds(sliders));
+    }
+    if (changed[TOGGLE] || !countsSent) {
+        sender.sendControlCount(TOGGLE, countIds(switches));
+    }
+    countsSent = true;
 
-            buttons.push_back(b);
-            controls.push_back(static_cast<Control*>(b));
-        } else if (isSlider(i)) {
-            cv::RotatedRect rect = finder.getMinAreaRect(i);
-            Slider *s = new Slider(rect, sender);
+    return any;
+}
 
-            sliders.push_back(s);
-            controls.push_back(static_cast<Control*>(s));
-        } else if (isSwitch(i)) {
-            cv::RotatedRect rect = finder.getMinAreaRect(i);
-            Switch *s = new Switch(rect, sender);
+//---------------------------------------------------------
+const vector<ControlShape>& ControlManager::getLayout() {
+    layout.clear();
+    addShapes(buttons, layout);
+    addShapes(sliders, layout);
+    addShapes(switches, layout);
+    return layout;
+}
+
+//---------------------------------------------------------
+bool ControlManager::sameLayout(const vector<ControlShape> &a, const vector<ControlShape> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
 
-            switches.push_back(s);
-            controls.push_back(static_cast<Control*>(s));
+    vector<bool> used(b.size(), false);
+    for (size_t i = 0; i < a.size(); i++) {
+        bool found = false;
+        for (size_t j = 0; j < b.size() && !found; j++) {
+            if (!used[j] && matches(a[i], b[j])) {
+                used[j] = true;
+                found = true;
+            }
+        }
+        if (!found) {
+            return false;
         }
     }
-    
-    assignControls();
+    return true;
+}
 
-    sender.sendControlCount(MOMENTARY, buttons.size());
-    sender.sendControlCount(CONTINUOUS, sliders.size());
-    sender.sendControlCount(TOGGLE, switches.size());
+//---------------------------------------------------------
+bool ControlManager::matches(const ControlShape &a, const ControlShape &b) {
+    if (a.type != b.type) {
+        return false;
+    }
+    if (a.type == MOMENTARY) {
+        return Button(a, sender) == Button(b, sender);
+    }
+    // Sliders and switches both compare as rectangles
+    return Slider(a, sender) == Slider(b, sender);
 }
 
 //---------------------------------------------------------
-void ControlManager::assignControls() {
-    for (size_t i = 0; i < buttons.size(); i++) {
-        buttons[i]->setId((int) i);
-        buttons[i]->setColor(colors[i % colors.size()]);
+template <class T>
+bool ControlManager::merge(vector<T> &current, vector<T> &next, ControlType type,
+        const vector<ControlShape> &newLayout, vector<int>::iterator keptAs) {
+    bool changed = false;
+    next.clear();
+
+    for (size_t s = 0; s < newLayout.size(); s++) {
+        if (newLayout[s].type != type) {
+            continue;
+        }
+        T candidate(newLayout[s], sender);
+
+        bool found = false;
+        for (size_t i = 0; i < current.size() && !found; i++) {
+            if (keptAs[i] < 0 && current[i] == candidate) {
+                keptAs[i] = (int) next.size();
+                next.push_back(current[i]);
+                found = true;
+            }
+        }
+
+        if (!found) {
+            next.push_back(candidate);
+            changed = true;
+        }
+    }
+
+    usedIds.clear();
+    for (size_t i = 0; i < current.size(); i++) {
+        if (keptAs[i] >= 0) {
+            int id = current[i].getId();
+            if ((size_t) id >= usedIds.size()) {
+                usedIds.resize(id + 1, false);
+            }
+            usedIds[id] = true;
+        } else {
+            current[i].release();
+            changed = true;
+        }
     }
-    
-    for (size_t i = 0; i < sliders.size(); i++) {
-        sliders[i]->setId((int) i);
-        sliders[i]->setColor(colors[i % colors.size()]);
+
+    // New controls get the ID they asked for if nothing else has it...
+    for (size_t i = 0; i < next.size(); i++) {
+        int id = next[i].getShape().id;
+        if (next[i].getId() >= 0 || id < 0) {
+            continue;
+        }
+        if ((size_t) id >= usedIds.size()) {
+            usedIds.resize(id + 1, false);
+        }
+        if (!usedIds[id]) {
+            usedIds[id] = true;
+            next[i].setId(id);
+        }
     }
-    
-    for (size_t i = 0; i < switches.size(); i++) {
-        switches[i]->setId((int) i);
-        switches[i]->setColor(colors[i % colors.size()]);
+
+    // ...and otherwise fill in the gaps
+    int id = 0;
+    for (size_t i = 0; i < next.size(); i++) {
+        if (next[i].getId() >= 0) {
+            continue;
+        }
+        while ((size_t) id < usedIds.size() && usedIds[id]) {
+            id++;
+        }
+        next[i].setId(id++);
     }
+
+    current.swap(next);
+    return changed;
 }
 
 //---------------------------------------------------------
-void ControlManager::processInteraction(const ofPoint &point) {
-    lastInputPoint = point;
-    for (size_t i = 0; i < controls.size(); i++) {
-        if (controls[i]->onInteraction(point)) {
-            // Stop after the first control to handle this input
-            break;
+void ControlManager::processTouches(const vector<Touch> &touches) {
+    inputPoints.clear();
+    nextOwners.clear();
+
+    // Both lists are in ID order, so walk them together
+    size_t o = 0;
+    for (size_t t = 0; t < touches.size(); t++) {
+        const Touch &touch = touches[t];
+
+        // Touches that went away let go of their controls
+        for (; o < owners.size() && owners[o].touch < touch.id; o++) {
+            release(owners[o].control);
+            controlOwners[owners[o].control] = -1;
         }
+
+        int owned = -1;
+        if (o < owners.size() && owners[o].touch == touch.id) {
+            owned = owners[o++].control;
+        }
+
+        Owner owner;
+        owner.touch = touch.id;
+
+        // A touch that's missing for a moment keeps what it has
+        if (!touch.active) {
+            if (owned >= 0) {
+                owner.control = owned;
+                nextOwners.push_back(owner);
+            }
+            continue;
+        }
+
+        // A finger lifted off the paper lets go, but keeps its ID in case it
+        // comes back down
+        if (!touch.contact) {
+            if (owned >= 0) {
+                release(owned);
+                controlOwners[owned] = -1;
+            }
+            continue;
+        }
+        inputPoints.push_back(touch.point);
+
+        if (owned >= 0) {
+            if (onInteraction(owned, touch.point) && contains(owned, touch.point)) {
+                owner.control = owned;
+                nextOwners.push_back(owner);
+                continue;
+            }
+            controlOwners[owned] = -1;
+        }
+
+        // Otherwise the first free control under the touch takes it
+        index.query(touch.point.x, touch.point.y, candidates);
+        for (size_t i = 0; i < candidates.size(); i++) {
+            size_t c = candidates[i];
+            if (controlOwners[c] < 0 && onInteraction(c, touch.point)) {
+                controlOwners[c] = touch.id;
+                owner.control = c;
+                nextOwners.push_back(owner);
+                break;
+            }
+        }
+    }
+
+    for (; o < owners.size(); o++) {
+        release(owners[o].control);
+        controlOwners[owners[o].control] = -1;
+    }
+    owners.swap(nextOwners);
+}
+
+//---------------------------------------------------------
+size_t ControlManager::size() {
+    return buttons.size() + sliders.size() + switches.size();
+}
+
+//---------------------------------------------------------
+bool ControlManager::contains(size_t c, const ofPoint &point) {
+    if (c < buttons.size()) {
+        return buttons[c].contains(point.x, point.y);
+    }
+    c -= buttons.size();
+    if (c < sliders.size()) {
+        return sliders[c].contains(point.x, point.y);
     }
+    return switches[c - sliders.size()].contains(point.x, point.y);
 }
 
 //---------------------------------------------------------
-void ControlManager::drawControls() {
-    size_t n = controls.size();
-    for (size_t i = 0; i < n; i++) {
-        controls[i]->draw();
+bool ControlManager::onInteraction(size_t c, const ofPoint &point) {
+    if (c < buttons.size()) {
+        return buttons[c].onInteraction(point.x, point.y);
     }
+    c -= buttons.size();
+    if (c < sliders.size()) {
+        return sliders[c].onInteraction(point.x, point.y);
+    }
+    return switches[c - sliders.size()].onInteraction(point.x, point.y);
+}
 
+//---------------------------------------------------------
+void ControlManager::release(size_t c) {
+    if (c < buttons.size()) {
+        buttons[c].release();
+        return;
+    }
+    c -= buttons.size();
+    if (c < sliders.size()) {
+        sliders[c].release();
+        return;
+    }
+    switches[c - sliders.size()].release();
+}
+
+//---------------------------------------------------------
+void ControlManager::drawControls(const Homography &projector, const Homography *paper) {
+    // Built here rather than in setLayout(), which can run without a GL
+    // context
+    if (sceneChanged) {
+        scene.build(buttons, sliders, switches);
+        sceneChanged = false;
+    } else {
+        scene.update(buttons, sliders, switches);
+    }
+    scene.setTransform(projector, paper);
+    scene.draw();
+
+    ofPushMatrix();
+    glMultMatrixf(scene.getMatrix());
     ofSetColor(accent1);
     ofFill();
-    ofCircle(lastInputPoint.x, lastInputPoint.y, 5);
+    for (size_t i = 0; i < inputPoints.size(); i++) {
+        ofCircle(inputPoints[i].x, inputPoints[i].y, 5);
+    }
+    ofPopMatrix();
 }
 
 //---------------------------------------------------------
@@ -151,40 +421,11 @@ OscSender& ControlManager::getSender() {
 }
 
 //---------------------------------------------------------
-void ControlManager::drawDetectorInput(float x, float y, float w, float h) {
-    ofxCv::drawMat(edges, x, y, w, h);
+ControlDetector& ControlManager::getDetector() {
+    return detector;
 }
 
 //---------------------------------------------------------
-bool ControlManager::isButton(size_t i) {
-    float radius;
-    finder.getMinEnclosingCircle(i, radius);
-
-    float circleArea = PI * radius * radius;
-    double contourArea = finder.getContourArea(i);
-
-    return abs(1.0 - circleArea / contourArea) < 0.3;
-}
-
-//---------------------------------------------------------
-bool ControlManager::isSlider(size_t i) {
-    float radius;
-    ofVec2f center = ofxCv::toOf(finder.getMinEnclosingCircle(i, radius));
-
-    float circleArea = PI * radius * radius;
-    double contourArea = finder.getContourArea(i);
-
-    // TODO Possibly consider width/height ratio as well
-    return circleArea / contourArea > 12;
-}
-
-//---------------------------------------------------------
-bool ControlManager::isSwitch(size_t i) {
-    RotatedRect rr = finder.getMinAreaRect(i);
-
-    float rectArea = rr.size.width * rr.size.height;
-    double contourArea = finder.getContourArea(i);
-
-    return abs(1.0 - rectArea / contourArea) < 0.25
-        && abs(1.0 - (float) rr.size.width / rr.size.height) > 0.1;
+const Mat& ControlManager::getDetectorInput() {
+    return detector.getInput();
 }
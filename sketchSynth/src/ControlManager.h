@@ -6,17 +6,24 @@
 #include "ofxCv.h"
 
 #include "Control.h"
+#include "ControlDetector.h"
+#include "ControlIndex.h"
+#include "ControlScene.h"
 #include "OscSender.h"
+#include "TouchTracker.h"
 
 class ControlManager {
 public:
+    ControlManager();
     ~ControlManager();
 
     void setup();
     void reset();
 
-    void drawControls();
-    void drawDetectorInput(float x, float y, float w, float h);
+    // Draws the controls and touches, from paper coordinates through the
+    // paper transform, if there is one, and then the projector's
+    void drawControls(const Homography &projector, const Homography *paper);
+    const cv::Mat& getDetectorInput();
 
     vector< pair<string, size_t> > listControls();
 
@@ -26,40 +33,84 @@ public:
     }
     void detect(cv::Mat img);
 
-    void processInteraction(const ofPoint &point);
+    // Brings the controls in line with a layout. Controls that match one in
+    // the layout, by their own operator==, are left alone and keep their ID
+    // and value; the rest are removed, or added with the ID in their shape
+    // if it's free and the lowest free one if not.
+    // Only control types that changed send a new /paper/count. Returns
+    // whether anything changed.
+    bool setLayout(const vector<ControlShape> &layout);
+
+    // The current controls, with their IDs
+    const vector<ControlShape>& getLayout();
+
+    // True if the layouts have the same controls, by the same tolerances
+    bool sameLayout(const vector<ControlShape> &a, const vector<ControlShape> &b);
+
+    // Each touch uses at most one control, and keeps it until it moves off
+    // or goes away. Touches must be in order of ID.
+    void processTouches(const vector<Touch> &touches);
 
     OscSender& getSender();
+    ControlDetector& getDetector();
 
     static const ofColor accent1;
     static const ofColor accent2;
 
 private:
-    void assignControls();
+    bool matches(const ControlShape &a, const ControlShape &b);
 
-    bool isButton(size_t i);
-    bool isSlider(size_t i);
-    bool isSwitch(size_t i);
-
-    OscSender sender;
-
-    ofxCv::ContourFinder finder;
-
-    cv::Mat grayImg;
-    cv::Mat edgesInput;
-    cv::Mat edges;
+    template <class T>
+    bool merge(vector<T> &current, vector<T> &next, ControlType type,
+            const vector<ControlShape> &layout, vector<int>::iterator keptAs);
 
-    // Store the actual controls
-    vector<Button*> buttons;
-    vector<Slider*> sliders;
-    vector<Switch*>  switches;
+    // Controls are numbered buttons first, then sliders, then switches
+    size_t size();
+    bool contains(size_t control, const ofPoint &point);
+    bool onInteraction(size_t control, const ofPoint &point);
+    void release(size_t control);
 
-    // Store pointers for batch operations
-    vector<Control*> controls;
+    OscSender sender;
 
-    ofPoint lastInputPoint;
+    ControlDetector detector;
+    vector<ControlShape> layout;
+    vector<ControlShape> detected;
+
+    // Each type of control back to back. Layout changes are merged into
+    // the next arrays and swapped in, and nothing is ever freed, so once
+    // these have grown changing the layout doesn't allocate.
+    vector<Button> buttons;
+    vector<Slider> sliders;
+    vector<Switch> switches;
+    vector<Button> nextButtons;
+    vector<Slider> nextSliders;
+    vector<Switch> nextSwitches;
+
+    // Where each control went in the last merge, or -1 if it was removed
+    vector<int> remap;
+    vector<bool> usedIds;
+    vector<ofRectangle> bounds;
+    bool countsSent;
+
+    // Finds the controls under a touch
+    ControlIndex index;
+    vector<size_t> candidates;
+
+    // Which touch is using which control, in order of touch ID
+    struct Owner {
+        int touch;
+        size_t control;
+    };
+    vector<Owner> owners;
+    vector<Owner> nextOwners;
+    vector<int> controlOwners;
+
+    vector<ofPoint> inputPoints;
+
+    ControlScene scene;
+    bool sceneChanged;
 
     vector<ofColor> colors;
 
-    static const int BORDER = 8;
     static const float ALPHA = 0.7;
 };
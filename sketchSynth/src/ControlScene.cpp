@@ -0,0 +1,163 @@
+#include <string.h>
+
+#include "ControlScene.h"
+
+namespace {
+    const float identity[16] = {
+        1, 0, 0, 0,
+        0, 1, 0, 0,
+        0, 0, 1, 0,
+        0, 0, 0, 1
+    };
+
+    template <class T>
+    void tessellate(vector<T> &controls, ofVec3f *&v, ofFloatColor *&c) {
+        for (size_t i = 0; i < controls.size(); i++) {
+            controls[i].tessellate(v, c);
+            v += T::shapeVertices;
+            c += T::shapeVertices;
+        }
+    }
+
+    template <class T>
+    void tessellateState(vector<T> &controls, ofVec3f *&v, ofFloatColor *&c, float *&state) {
+        for (size_t i = 0; i < controls.size(); i++) {
+            controls[i].tessellateState(v, c);
+            *state++ = controls[i].getState();
+            v += T::stateVertices;
+            c += T::stateVertices;
+        }
+    }
+
+    // Only rewrites the controls whose state changed
+    template <class T>
+    bool updateState(vector<T> &controls, ofVec3f *&v, float *&state) {
+        bool changed = false;
+        for (size_t i = 0; i < controls.size(); i++) {
+            float s = controls[i].getState();
+            if (s != *state) {
+                *state = s;
+                controls[i].tessellateState(v, NULL);
+                changed = true;
+            }
+            state++;
+            v += T::stateVertices;
+        }
+        return changed;
+    }
+
+    template <class T>
+    size_t countVertices(vector<T> &controls, int perControl) {
+        return controls.size() * perControl;
+    }
+}
+
+//---------------------------------------------------------
+ControlScene::ControlScene() {
+    memcpy(projectorMatrix, identity, sizeof(identity));
+    memcpy(paperMatrix, identity, sizeof(identity));
+    memcpy(matrix, identity, sizeof(identity));
+}
+
+//---------------------------------------------------------
+void ControlScene::clear() {
+    shapeVertices.clear();
+    shapeColors.clear();
+    stateVertices.clear();
+    stateColors.clear();
+    states.clear();
+}
+
+//---------------------------------------------------------
+void ControlScene::build(vector<Button> &buttons, vector<Slider> &sliders, vector<Switch> &switches) {
+    clear();
+
+    size_t nShape = countVertices(buttons, Button::shapeVertices)
+        + countVertices(sliders, Slider::shapeVertices)
+        + countVertices(switches, Switch::shapeVertices);
+    size_t nState = countVertices(buttons, Button::stateVertices)
+        + countVertices(sliders, Slider::stateVertices)
+        + countVertices(switches, Switch::stateVertices);
+    if (nShape == 0) {
+        return;
+    }
+
+    shapeVertices.resize(nShape);
+    shapeColors.resize(nShape);
+    ofVec3f *v = &shapeVertices[0];
+    ofFloatColor *c = &shapeColors[0];
+    tessellate(buttons, v, c);
+    tessellate(sliders, v, c);
+    tessellate(switches, v, c);
+
+    stateVertices.resize(nState);
+    stateColors.resize(nState);
+    states.resize(buttons.size() + sliders.size() + switches.size());
+    v = &stateVertices[0];
+    c = &stateColors[0];
+    float *state = &states[0];
+    tessellateState(buttons, v, c, state);
+    tessellateState(sliders, v, c, state);
+    tessellateState(switches, v, c, state);
+
+    shapeVbo.setVertexData(&shapeVertices[0], nShape, GL_STATIC_DRAW);
+    shapeVbo.setColorData(&shapeColors[0], nShape, GL_STATIC_DRAW);
+    stateVbo.setVertexData(&stateVertices[0], nState, GL_DYNAMIC_DRAW);
+    stateVbo.setColorData(&stateColors[0], nState, GL_STATIC_DRAW);
+}
+
+//---------------------------------------------------------
+void ControlScene::update(vector<Button> &buttons, vector<Slider> &sliders, vector<Switch> &switches) {
+    if (states.empty()) {
+        return;
+    }
+
+    ofVec3f *v = &stateVertices[0];
+    float *state = &states[0];
+    bool changed = updateState(buttons, v, state);
+    changed = updateState(sliders, v, state) || changed;
+    changed = updateState(switches, v, state) || changed;
+    if (changed) {
+        stateVbo.updateVertexData(&stateVertices[0], stateVertices.size());
+    }
+}
+
+//---------------------------------------------------------
+void ControlScene::setTransform(const Homography &projector, const Homography *paper) {
+    const float *p = projector.getGLMatrix();
+    const float *q = paper != NULL ? paper->getGLMatrix() : identity;
+    if (memcmp(p, projectorMatrix, sizeof(projectorMatrix)) == 0
+            && memcmp(q, paperMatrix, sizeof(paperMatrix)) == 0) {
+        return;
+    }
+    memcpy(projectorMatrix, p, sizeof(projectorMatrix));
+    memcpy(paperMatrix, q, sizeof(paperMatrix));
+
+    // Both are column major, and the paper transform applies first
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0;
+            for (int k = 0; k < 4; k++) {
+                sum += p[k * 4 + row] * q[col * 4 + k];
+            }
+            matrix[col * 4 + row] = sum;
+        }
+    }
+}
+
+//---------------------------------------------------------
+const float* ControlScene::getMatrix() const {
+    return matrix;
+}
+
+//---------------------------------------------------------
+void ControlScene::draw() {
+    if (shapeVertices.empty()) {
+        return;
+    }
+    ofPushMatrix();
+    glMultMatrixf(matrix);
+    shapeVbo.draw(GL_TRIANGLES, 0, shapeVertices.size());
+    stateVbo.draw(GL_TRIANGLES, 0, stateVertices.size());
+    ofPopMatrix();
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "Control.h"
+#include "Homography.h"
+
+/*
+ * The controls as the projector shows them, kept in two vertex buffers. The
+ * one with every control's outline is only built when the layout changes.
+ * The other holds what moves as controls are used, button fills, slider
+ * knobs and switch crosses, with a fixed slice for each control that's only
+ * rewritten when its state changes. Both are drawn under one matrix, which
+ * is only multiplied out again when a transform changes, so a frame is two
+ * draw calls however many controls there are.
+ */
+class ControlScene {
+public:
+    ControlScene();
+
+    void clear();
+    void build(vector<Button> &buttons, vector<Slider> &sliders, vector<Switch> &switches);
+    void update(vector<Button> &buttons, vector<Slider> &sliders, vector<Switch> &switches);
+
+    // Paper coordinates to the projector, through the camera. paper can be
+    // NULL before the paper is found.
+    void setTransform(const Homography &projector, const Homography *paper);
+    const float* getMatrix() const;
+
+    void draw();
+
+private:
+    vector<ofVec3f> shapeVertices;
+    vector<ofFloatColor> shapeColors;
+    ofVbo shapeVbo;
+
+    vector<ofVec3f> stateVertices;
+    vector<ofFloatColor> stateColors;
+    vector<float> states;
+    ofVbo stateVbo;
+
+    float projectorMatrix[16];
+    float paperMatrix[16];
+    float matrix[16];
+};
@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <fstream>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FrameSource.h"
+
+using cv::Mat;
+
+//---------------------------------------------------------
+CameraFrameSource::CameraFrameSource(int width, int height, int deviceId)
+    : width(width)
+    , height(height)
+    , deviceId(deviceId)
+    , timestamp(0)
+{
+}
+
+//---------------------------------------------------------
+bool CameraFrameSource::setup() {
+    // Frames are uploaded by whoever draws them, possibly on another thread
+    camera.setUseTexture(false);
+    camera.setDeviceID(deviceId);
+    bool ok = camera.initGrabber(width, height);
+    camera.listDevices();
+    return ok;
+}
+
+//---------------------------------------------------------
+void CameraFrameSource::close() {
+    camera.close();
+}
+
+//---------------------------------------------------------
+bool CameraFrameSource::update() {
+    camera.update();
+    if (camera.isFrameNew()) {
+        timestamp = ofGetElapsedTimeMillis();
+        return true;
+    }
+    return false;
+}
+
+//---------------------------------------------------------
+Mat CameraFrameSource::getFrame() {
+    return ofxCv::toCv(camera);
+}
+
+//---------------------------------------------------------
+unsigned long long CameraFrameSource::getTimestamp() {
+    return timestamp;
+}
+
+//---------------------------------------------------------
+int CameraFrameSource::getWidth() {
+    return camera.getWidth();
+}
+
+//---------------------------------------------------------
+int CameraFrameSource::getHeight() {
+    return camera.getHeight();
+}
+
+
+//---------------------------------------------------------
+ReplayFrameSource::ReplayFrameSource(const string &path, bool realtime, bool loop)
+    : path(path)
+    , realtime(realtime)
+    , loop(loop)
+    , mapped(NULL)
+    , mappedSize(0)
+    , chroma(CHROMA_420)
+    , width(0)
+    , height(0)
+    , current(0)
+    , started(false)
+    , finished(false)
+    , startTime(0)
+    , loopOffset(0)
+    , skipped(0)
+{
+}
+
+//---------------------------------------------------------
+ReplayFrameSource::~ReplayFrameSource() {
+    close();
+}
+
+//---------------------------------------------------------
+bool ReplayFrameSource::setup() {
+    // Paths come from the command line, so don't let oF make them relative
+    // to the data folder
+    char resolved[PATH_MAX];
+    if (realpath(path.c_str(), resolved) == NULL) {
+        ofLog(OF_LOG_ERROR, "Replay source " + path + " does not exist");
+        return false;
+    }
+    path = resolved;
+
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) {
+        return false;
+    }
+
+    bool ok = S_ISDIR(info.st_mode) ? openDirectory() : openVideo();
+    if (!ok || size() == 0) {
+        ofLog(OF_LOG_ERROR, "Could not read any frames from " + path);
+        return false;
+    }
+
+    ofLog(OF_LOG_NOTICE, "Replaying " + ofToString(size()) + " frames ("
+            + ofToString(width) + "x" + ofToString(height) + ") from " + path);
+    return true;
+}
+
+//---------------------------------------------------------
+void ReplayFrameSource::close() {
+    if (mapped != NULL) {
+        munmap(mapped, mappedSize);
+        mapped = NULL;
+        mappedSize = 0;
+    }
+    frameOffsets.clear();
+    imagePaths.clear();
+    images.clear();
+}
+
+//---------------------------------------------------------
+bool ReplayFrameSource::openVideo() {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    mappedSize = info.st_size;
+    void *m = mmap(NULL, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED) {
+        mappedSize = 0;
+        return false;
+    }
+    mapped = (unsigned char *) m;
+    madvise(mapped, mappedSize, MADV_SEQUENTIAL);
+
+    const char *data = (const char *) mapped;
+    const char *end = data + mappedSize;
+    const char *eol = std::find(data, end, '\n');
+
+    string header(data, eol);
+    if (header.compare(0, 10, "YUV4MPEG2 ") != 0 || eol == end) {
+        ofLog(OF_LOG_ERROR, path + " is not a YUV4MPEG2 file");
+        return false;
+    }
+
+    float fps = 30;
+    vector<string> params = ofSplitString(header.substr(10), " ", true, true);
+    for (size_t i = 0; i < params.size(); i++) {
+        const string &p = params[i];
+        switch (p[0]) {
+            case 'W':
+                width = ofToInt(p.substr(1));
+                break;
+            case 'H':
+                height = ofToInt(p.substr(1));
+                break;
+            case 'F': {
+                vector<string> rate = ofSplitString(p.substr(1), ":");
+                if (rate.size() == 2 && ofToFloat(rate[1]) > 0) {
+                    fps = ofToFloat(rate[0]) / ofToFloat(rate[1]);
+                }
+                break;
+            }
+            case 'C':
+                if (p.compare(1, 3, "420") == 0) {
+                    chroma = CHROMA_420;
+                } else if (p == "C444") {
+                    chroma = CHROMA_444;
+                } else if (p == "Cmono") {
+                    chroma = CHROMA_MONO;
+                } else {
+                    ofLog(OF_LOG_ERROR, "Unsupported Y4M colorspace " + p);
+                    return false;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+
+    size_t planeSize = (size_t) width * height;
+    size_t frameSize = planeSize;
+    if (chroma == CHROMA_420) {
+        frameSize += 2 * (planeSize / 4);
+    } else if (chroma == CHROMA_444) {
+        frameSize += 2 * planeSize;
+    }
+
+    // Index every frame now so playback can seek without parsing
+    const char *pos = eol + 1;
+    while (end - pos > 5 && std::equal(pos, pos + 5, "FRAME")) {
+        const char *frameEol = std::find(pos, end, '\n');
+        if (frameEol == end || (size_t) (end - frameEol - 1) < frameSize) {
+            break;
+        }
+        frameOffsets.push_back(frameEol + 1 - data);
+        pos = frameEol + 1 + frameSize;
+    }
+
+    loadTimestamps(path + ".timestamps", fps);
+    return true;
+}
+
+//---------------------------------------------------------
+bool ReplayFrameSource::openDirectory() {
+    DIR *dir = opendir(path.c_str());
+    if (dir == NULL) {
+        return false;
+    }
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        string name = entry->d_name;
+        string ext = ofToLower(name.substr(name.find_last_of('.') + 1));
+        if (ext == "png" || ext == "jpg" || ext == "jpeg" || ext == "bmp"
+                || ext == "tif" || ext == "tiff" || ext == "ppm" || ext == "pgm") {
+            imagePaths.push_back(path + "/" + name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(imagePaths.begin(), imagePaths.end());
+    if (imagePaths.empty()) {
+        return false;
+    }
+
+    // Decoding as frames are played would time the disk and the decoder
+    // along with everything else
+    ofImage image;
+    image.setUseTexture(false);
+    images.resize(imagePaths.size());
+    for (size_t i = 0; i < imagePaths.size(); i++) {
+        if (!image.loadImage(imagePaths[i])) {
+            ofLog(OF_LOG_ERROR, "Could not load " + imagePaths[i]);
+            return false;
+        }
+        image.setImageType(OF_IMAGE_COLOR);
+        if (i == 0) {
+            width = image.getWidth();
+            height = image.getHeight();
+        } else if (image.getWidth() != width || image.getHeight() != height) {
+            ofLog(OF_LOG_ERROR, imagePaths[i] + " is not the same size as the first image");
+            return false;
+        }
+        ofxCv::toCv(image).copyTo(images[i]);
+    }
+
+    loadTimestamps(path + "/timestamps.txt", 30);
+    return true;
+}
+
+//---------------------------------------------------------
+void ReplayFrameSource::loadTimestamps(const string &file, float fps) {
+    timestamps.clear();
+
+    std::ifstream in(file.c_str());
+    unsigned long long t;
+    while (timestamps.size() < size() && in >> t) {
+        timestamps.push_back(t);
+    }
+
+    // Anything missing is filled in from the nominal frame rate
+    float interval = 1000.0 / fps;
+    for (size_t i = timestamps.size(); i < size(); i++) {
+        if (i == 0) {
+            timestamps.push_back(0);
+        } else {
+            timestamps.push_back(timestamps[i - 1] + (unsigned long long) interval);
+        }
+    }
+}
+
+//---------------------------------------------------------
+bool ReplayFrameSource::update() {
+    const size_t n = size();
+    if (finished || n == 0) {
+        return false;
+    }
+
+    if (!started) {
+        started = true;
+        startTime = ofGetElapsedTimeMillis();
+        current = 0;
+        decodeFrame(current);
+        return true;
+    }
+
+    unsigned long long first = timestamps[0];
+    unsigned long long duration = timestamps[n - 1] - first;
+    unsigned long long interval = n > 1 ? duration / (n - 1) : 33;
+
+    size_t next = current + 1;
+    if (realtime) {
+        // Jump to the newest frame that's due, skipping any we were too slow for
+        unsigned long long elapsed = ofGetElapsedTimeMillis() - startTime;
+        if (next < n && timestamps[next] - first > elapsed) {
+            return false;
+        }
+        while (next + 1 < n && timestamps[next + 1] - first <= elapsed) {
+            next++;
+        }
+        if (next >= n && elapsed < duration + interval) {
+            return false;
+        }
+        if (next < n) {
+            skipped += next - current - 1;
+        }
+    }
+
+    if (next >= n) {
+        if (!loop) {
+            finished = true;
+            return false;
+        }
+        loopOffset += duration + interval;
+        startTime = ofGetElapsedTimeMillis();
+        next = 0;
+    }
+
+    current = next;
+    decodeFrame(current);
+    return true;
+}
+
+//---------------------------------------------------------
+void ReplayFrameSource::decodeFrame(size_t i) {
+    if (!images.empty()) {
+        // A copy, so nothing done to the frame changes the next loop
+        images[i].copyTo(frame);
+        return;
+    }
+
+    unsigned char *y = mapped + frameOffsets[i];
+    Mat luma(height, width, CV_8UC1, y);
+    if (chroma == CHROMA_MONO) {
+        cv::cvtColor(luma, frame, CV_GRAY2RGB);
+        return;
+    }
+
+    // OpenCV wants Y, Cr, Cb, which is Y, V, U in Y4M terms
+    size_t planeSize = (size_t) width * height;
+    planes[0] = luma;
+    if (chroma == CHROMA_444) {
+        planes[2] = Mat(height, width, CV_8UC1, y + planeSize);
+        planes[1] = Mat(height, width, CV_8UC1, y + 2 * planeSize);
+    } else {
+        Mat u(height / 2, width / 2, CV_8UC1, y + planeSize);
+        Mat v(height / 2, width / 2, CV_8UC1, y + planeSize + planeSize / 4);
+        cv::resize(u, planes[2], cv::Size(width, height), 0, 0, cv::INTER_NEAREST);
+        cv::resize(v, planes[1], cv::Size(width, height), 0, 0, cv::INTER_NEAREST);
+    }
+    cv::merge(planes, 3, ycrcb);
+    cv::cvtColor(ycrcb, frame, CV_YCrCb2RGB);
+}
+
+//---------------------------------------------------------
+Mat ReplayFrameSource::getFrame() {
+    return frame;
+}
+
+//---------------------------------------------------------
+unsigned long long ReplayFrameSource::getTimestamp() {
+    if (timestamps.empty()) {
+        return 0;
+    }
+    return loopOffset + timestamps[current] - timestamps[0];
+}
+
+//---------------------------------------------------------
+int ReplayFrameSource::getWidth() {
+    return width;
+}
+
+//---------------------------------------------------------
+int ReplayFrameSource::getHeight() {
+    return height;
+}
+
+//---------------------------------------------------------
+unsigned long ReplayFrameSource::getSkippedFrames() {
+    return skipped;
+}
+
+//---------------------------------------------------------
+bool ReplayFrameSource::isFinished() {
+    return finished;
+}
+
+//---------------------------------------------------------
+size_t ReplayFrameSource::size() {
+    return imagePaths.empty() ? frameOffsets.size() : imagePaths.size();
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+/*
+ * Where the vision pipeline gets its frames. Frames are RGB, and stay valid
+ * until the next call to update().
+ */
+class FrameSource {
+public:
+    virtual ~FrameSource() {}
+
+    virtual bool setup() = 0;
+    virtual void close() {}
+
+    // Advance to the newest frame, returning false if there isn't one yet
+    virtual bool update() = 0;
+    virtual cv::Mat getFrame() = 0;
+
+    // Capture time of the current frame, in milliseconds
+    virtual unsigned long long getTimestamp() = 0;
+
+    virtual int getWidth() = 0;
+    virtual int getHeight() = 0;
+
+    // Frames that were never returned by update() because a newer one was
+    // already available
+    virtual unsigned long getSkippedFrames() {
+        return 0;
+    }
+
+    virtual bool isFinished() {
+        return false;
+    }
+};
+
+//---------------------------------------------------------
+class CameraFrameSource : public FrameSource {
+public:
+    CameraFrameSource(int width = 640, int height = 480, int deviceId = 0);
+
+    bool setup();
+    void close();
+
+    bool update();
+    cv::Mat getFrame();
+    unsigned long long getTimestamp();
+
+    int getWidth();
+    int getHeight();
+
+private:
+    ofVideoGrabber camera;
+
+    int width;
+    int height;
+    int deviceId;
+
+    unsigned long long timestamp;
+};
+
+//---------------------------------------------------------
+/*
+ * Plays back a recorded sequence, either a YUV4MPEG2 (.y4m) file or a
+ * directory of images. Y4M files are memory mapped and the planes are read
+ * in place. Images are all decoded by setup(), so neither puts disk reads
+ * or image decoding in the time update() takes, but a directory is held in
+ * memory at three bytes a pixel. Frame times come from a "timestamps" file next to the sequence
+ * (<file>.timestamps, or timestamps.txt inside the directory) holding one
+ * millisecond value per line, falling back to the Y4M frame rate or 30 fps.
+ *
+ * In real time mode frames are released on their original schedule and late
+ * frames are skipped like a camera would; otherwise every frame is returned
+ * as fast as it is asked for.
+ */
+class ReplayFrameSource : public FrameSource {
+public:
+    ReplayFrameSource(const string &path, bool realtime = true, bool loop = false);
+    ~ReplayFrameSource();
+
+    bool setup();
+    void close();
+
+    bool update();
+    cv::Mat getFrame();
+    unsigned long long getTimestamp();
+
+    int getWidth();
+    int getHeight();
+
+    unsigned long getSkippedFrames();
+    bool isFinished();
+
+    size_t size();
+
+private:
+    enum Chroma { CHROMA_MONO, CHROMA_420, CHROMA_444 };
+
+    bool openVideo();
+    bool openDirectory();
+    void loadTimestamps(const string &file, float fps);
+
+    void decodeFrame(size_t i);
+
+    string path;
+    bool realtime;
+    bool loop;
+
+    // Memory mapped Y4M file
+    unsigned char *mapped;
+    size_t mappedSize;
+    Chroma chroma;
+    vector<size_t> frameOffsets;
+
+    // Image sequence, decoded
+    vector<string> imagePaths;
+    vector<cv::Mat> images;
+
+    vector<unsigned long long> timestamps;
+
+    int width;
+    int height;
+
+    cv::Mat frame;
+    cv::Mat planes[3];
+    cv::Mat ycrcb;
+
+    size_t current;
+    bool started;
+    bool finished;
+    unsigned long long startTime;
+    unsigned long long loopOffset;
+    unsigned long skipped;
+};
@@ -1,3 +1,6 @@
+#include <algorithm>
+
+#include "Profiler.h"
 #include "ShapeUtils.h"
 
 #include "HandDetector.h"
@@ -8,10 +11,15 @@ using cv::Mat;
 //---------------------------------------------------------
 HandDetector::HandDetector()
     : fingerThreshold(40 * 40)
-    , useCenter(-1, -1)
 {
-    elem2x2 = Mat::ones(2, 2, CV_8U);
-    elem3x3 = Mat::ones(3, 3, CV_8U);
+    const cv::Point useCenter(-1, -1);
+
+    // Get rid of background noise with a lot of erosion, then fill in the
+    // holes in the hand, and then shrink it some for higher accuracy in
+    // finger detection
+    morphology.add(BinaryMorphology::ERODE, cv::Size(2, 2), useCenter, 6);
+    morphology.add(BinaryMorphology::DILATE, cv::Size(3, 3), useCenter, 5);
+    morphology.add(BinaryMorphology::ERODE, cv::Size(2, 2), useCenter, 3);
 
 	topFinder.setMinAreaRadius(20);
 	topFinder.setMaxAreaRadius(200);
@@ -19,51 +27,99 @@ HandDetector::HandDetector()
 }
 
 //---------------------------------------------------------
-bool HandDetector::detect(const cv::Mat &top, const ofPolyline &paper) {
-    // Join the hand by dilating small gaps, then get rid of background noise
-    // with a lot of erosion
-    cv::dilate(top, topFilled, elem2x2, useCenter, 2);
-    cv::erode(top, topFilled, elem2x2, useCenter, 6);
+bool HandDetector::detect(const cv::Mat &top, const ofPolyline &paper, const cv::Point &offset) {
+    onePaper.resize(1);
+    onePaper[0] = paper;
+    return detect(top, onePaper, offset);
+}
 
-    // Fill in the holes in the hand, and the shrink it some for higher
-    // accuracy in finger detection
-    cv::dilate(topFilled, topFilled, elem3x3, useCenter, 5);
-    cv::erode(topFilled, topFilled, elem2x2, useCenter, 3);
+//---------------------------------------------------------
+bool HandDetector::detect(const cv::Mat &top, const vector<ofPolyline> &papers, const cv::Point &offset) {
+    {
+        PROFILE_SCOPE(PROFILE_MORPHOLOGY);
+        filter(top);
+    }
+
+    {
+        PROFILE_SCOPE(PROFILE_CONTOURS);
+        findHands(offset);
+    }
 
+    PROFILE_SCOPE(PROFILE_FINGERTIPS);
+    return findFingers(papers);
+}
+
+//---------------------------------------------------------
+void HandDetector::filter(const cv::Mat &top) {
+    morphology.apply(top, topFilled);
+}
+
+//---------------------------------------------------------
+size_t HandDetector::findHands(const cv::Point &offset) {
     topFinder.findContours(topFilled);
 
+    // Every blob big enough to get past the finder is a hand, biggest first
     const size_t n = topFinder.size();
-    if (n > 0) {
-        float maxArea = -numeric_limits<float>::infinity();
-        size_t maxIndex = 0;
-
-        for (size_t i = 0; i < n; i++) {
-            float area = topFinder.getContourArea(i);
-            if (area > maxArea) {
-                maxArea = area;
-                maxIndex = i;
-            }
+    blobs.clear();
+    for (size_t i = 0; i < n; i++) {
+        blobs.push_back(make_pair(-topFinder.getContourArea(i), i));
+    }
+    std::sort(blobs.begin(), blobs.end());
+
+    hands.resize(n < maxHands ? n : maxHands);
+    for (size_t h = 0; h < hands.size(); h++) {
+        Hand &hand = hands[h];
+        hand.contour = ShapeUtils::filterPolyline(topFinder.getPolyline(blobs[h].second), 7);
+        hand.fingers.clear();
+        hand.tips.clear();
+        hand.found = false;
+
+        vector<ofPoint> &vertices = hand.contour.getVertices();
+        for (size_t i = 0; i < vertices.size(); i++) {
+            vertices[i] += ofPoint(offset.x, offset.y);
         }
-
-        contour = ShapeUtils::filterPolyline(topFinder.getPolyline(maxIndex), 7);
-        foundFingerInLast = findFingers(paper);
-    } else {
-        contour.clear();
-        fingers.clear();
-        foundFingerInLast = false;
     }
-    return foundFingerInLast;
+    return hands.size();
 }
 
 //---------------------------------------------------------
 bool HandDetector::findFingers(const ofPolyline &paper) {
+    onePaper.resize(1);
+    onePaper[0] = paper;
+    return findFingers(onePaper);
+}
+
+//---------------------------------------------------------
+bool HandDetector::findFingers(const vector<ofPolyline> &papers) {
+    bool any = false;
+    for (size_t h = 0; h < hands.size(); h++) {
+        any = findFingers(hands[h], papers) || any;
+    }
+    return any;
+}
+
+//---------------------------------------------------------
+bool HandDetector::inside(const vector<ofPolyline> &papers, float x, float y) {
+    for (size_t i = 0; i < papers.size(); i++) {
+        if (ShapeUtils::inside(papers[i], x, y)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//---------------------------------------------------------
+bool HandDetector::findFingers(Hand &hand, const vector<ofPolyline> &papers) {
     float mx = -numeric_limits<float>::infinity();
     float mn = numeric_limits<float>::infinity();
 
     bool lookForMax = true;
     size_t mxPos = 0;
 
+    const ofPolyline &contour = hand.contour;
+    vector<size_t> &fingers = hand.fingers;
     fingers.clear();
+    hand.tips.clear();
 
     ofPoint centroid = ShapeUtils::getCentroid2D(contour);
     for (size_t i = 0; i < contour.size(); i++) {
@@ -93,44 +149,83 @@ bool HandDetector::findFingers(const ofPolyline &paper) {
 
     // Find the farthest peak that's inside the paper
     float farthest = -numeric_limits<float>::infinity();
-    bool found = false;
-
-    ofPoint bestFinger;
     for (size_t i = 0; i < fingers.size(); i++) {
         float x = contour[fingers[i]].x;
         float y = contour[fingers[i]].y;
         float v = ofDistSquared(centroid.x, centroid.y, x, y);
-        if (v > farthest && ShapeUtils::inside(paper, x, y)) {
+        if (v > farthest && inside(papers, x, y)) {
             farthest = v;
-            bestFinger.set(x, y);
-            found = true;
         }
     }
 
-    if (found) {
-        if (foundFingerInLast) {
-            // Better than nothing, but we probably want a freaking Kalman
-            // filter, like usual
-            fingerPoint = fAlpha * fingerPoint + (1 - fAlpha) * bestFinger;
-        } else {
-            fingerPoint.set(bestFinger);
+    // And any others that reach out nearly as far
+    for (size_t i = 0; i < fingers.size(); i++) {
+        const ofPoint &p = contour[fingers[i]];
+        float v = ofDistSquared(centroid.x, centroid.y, p.x, p.y);
+        if (v >= tipRatio * farthest && inside(papers, p.x, p.y)) {
+            if (v == farthest) {
+                hand.tips.insert(hand.tips.begin(), p);
+            } else {
+                hand.tips.push_back(p);
+            }
         }
     }
 
-    return found;
+    hand.found = !hand.tips.empty();
+    return hand.found;
 }
 
 //---------------------------------------------------------
-ofPoint HandDetector::getFingerPoint() {
-    if (foundFingerInLast) {
-        return fingerPoint;
-    } else {
-        return ofPoint(-5, -5);
+const vector<Hand>& HandDetector::getHands() {
+    return hands;
+}
+
+//---------------------------------------------------------
+const Mat& HandDetector::getDetectorInput() {
+    return topFilled;
+}
+
+//---------------------------------------------------------
+const Mat& HandDetector::getHoldMask(int margin, const cv::Rect &region) {
+    holdMask.create(region.size(), CV_8UC1);
+    holdMask.setTo(0);
+    if (hands.empty()) {
+        return holdMask;
+    }
+
+    holdContours.resize(hands.size());
+    for (size_t h = 0; h < hands.size(); h++) {
+        const vector<ofPoint> &vertices = hands[h].contour.getVertices();
+        vector<cv::Point> &contour = holdContours[h];
+        contour.resize(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++) {
+            contour[i] = cv::Point(cvRound(vertices[i].x) - region.x, cvRound(vertices[i].y) - region.y);
+        }
+    }
+
+    // Outlining with a thick line grows the blobs like a round dilation
+    // would, for a lot less work
+    cv::fillPoly(holdMask, holdContours, cv::Scalar(255));
+    if (margin > 0) {
+        cv::polylines(holdMask, holdContours, true, cv::Scalar(255), 2 * margin + 1);
     }
+    return holdMask;
+}
+
+//---------------------------------------------------------
+BinaryMorphology& HandDetector::getMorphology() {
+    return morphology;
 }
 
 //---------------------------------------------------------
 void HandDetector::draw() {
+    for (size_t i = 0; i < hands.size(); i++) {
+        hands[i].draw();
+    }
+}
+
+//---------------------------------------------------------
+void Hand::draw() {
     contour.draw();
     ofFill();
     for (size_t i = 0; i < fingers.size(); i++) {
@@ -139,9 +234,9 @@ void HandDetector::draw() {
         ofCircle(contour[p].x, contour[p].y, 10);
     }
 
-    if (foundFingerInLast) {
-        ofSetColor(0, 0, 255);
-        ofCircle(fingerPoint.x, fingerPoint.y, 10);
+    ofSetColor(0, 0, 255);
+    for (size_t i = 0; i < tips.size(); i++) {
+        ofCircle(tips[i].x, tips[i].y, 10);
     }
 
     if (contour.size() > 0) {
@@ -151,7 +246,8 @@ void HandDetector::draw() {
         ofCircle(centroid.x, centroid.y, 5);
     }
 }
-    
+
+//---------------------------------------------------------
 void HandDetector::drawDetectorInput(float x, float y, float w, float h) {
     ofxCv::drawMat(topFilled, x, y, w, h);
 }
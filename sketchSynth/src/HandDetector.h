@@ -3,40 +3,76 @@
 #include "ofMain.h"
 #include "ofxCv.h"
 
+#include "BinaryMorphology.h"
 #include "PaperDetector.h"
 
+// The drawable result of a detection, cheap enough to copy between threads
+struct Hand {
+    Hand() : found(false) {}
+
+    void draw();
+
+    ofPolyline contour;
+    vector<size_t> fingers;
+
+    // Fingertips that are on the paper, the farthest one first
+    vector<ofPoint> tips;
+    bool found;
+};
+
 class HandDetector {
 public:
     HandDetector();
 
     void draw();
     void drawDetectorInput(float x, float y, float w, float h);
-    
-    template <class T, class S>
-    bool detect(const T &top, const S &side, const ofPolyline &paper) {
-        return detect(ofxCv::toCv(top), ofxCv::toCv(side), paper);
-    }
-    bool detect(const cv::Mat &top, const ofPolyline &paper);
-    
-    ofPoint getFingerPoint();
 
-private:
+    // top can be a crop of the camera frame, with its top left corner at
+    // offset; hands come back in camera coordinates either way. Returns
+    // true if any fingertips are on the paper.
+    bool detect(const cv::Mat &top, const ofPolyline &paper, const cv::Point &offset = cv::Point());
+    // With several sheets, fingertips count on any of them
+    bool detect(const cv::Mat &top, const vector<ofPolyline> &papers, const cv::Point &offset = cv::Point());
+
+    // The stages of detect(), exposed so they can be timed separately
+    void filter(const cv::Mat &top);
+    size_t findHands(const cv::Point &offset = cv::Point());
     bool findFingers(const ofPolyline &paper);
+    bool findFingers(const vector<ofPolyline> &papers);
+
+    // Largest first
+    const vector<Hand>& getHands();
+    const cv::Mat& getDetectorInput();
+
+    // Where the hands from the last detect() were, filled in and grown by
+    // margin pixels, over region of the camera image. That needn't be the
+    // region they were found in. Meant for keeping a hand out of the
+    // background, without also keeping out anything else that changed
+    // while it was in view.
+    const cv::Mat& getHoldMask(int margin, const cv::Rect &region);
+
+    // The erode and dilate steps filter() runs on the foreground mask
+    BinaryMorphology& getMorphology();
+
+private:
+    bool findFingers(Hand &hand, const vector<ofPolyline> &papers);
+    static bool inside(const vector<ofPolyline> &papers, float x, float y);
 
     ofxCv::ContourFinder topFinder;
-    ofxCv::ContourFinder sideFinder;
-    
-    cv::Mat topFilled;
-    ofPolyline contour;
 
-    vector<size_t> fingers;
-    ofPoint fingerPoint;
-    bool foundFingerInLast;
+    cv::Mat topFilled;
+    cv::Mat holdMask;
+    vector< vector<cv::Point> > holdContours;
+    vector<Hand> hands;
+    vector< pair<float, size_t> > blobs;
+    vector<ofPolyline> onePaper;
 
     float fingerThreshold;
-    static const float fAlpha = 0.2;
 
-    cv::Mat elem2x2;
-    cv::Mat elem3x3;
-    const cv::Point useCenter;
+    static const size_t maxHands = 4;
+
+    // Other fingertips count if they're nearly as far out as the farthest
+    static const float tipRatio = 0.6;
+
+    BinaryMorphology morphology;
 };
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cfloat>
+
+#include "Homography.h"
+
+using cv::Mat;
+using cv::Point2f;
+
+//---------------------------------------------------------
+Homography::Homography() {
+    setIdentity();
+}
+
+//---------------------------------------------------------
+void Homography::setIdentity() {
+    const double identity[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    std::copy(identity, identity + 9, forward);
+    std::copy(identity, identity + 9, backward);
+
+    updateGL();
+
+    // No real quad looks like this, so the next set() always recomputes
+    std::fill(src, src + 4, Point2f(0, 0));
+    std::fill(dst, dst + 4, Point2f(0, 0));
+}
+
+//---------------------------------------------------------
+bool Homography::set(const Point2f newSrc[4], const Point2f newDst[4]) {
+    if (std::equal(newSrc, newSrc + 4, src) && std::equal(newDst, newDst + 4, dst)) {
+        return false;
+    }
+    std::copy(newSrc, newSrc + 4, src);
+    std::copy(newDst, newDst + 4, dst);
+
+    Mat f(3, 3, CV_64F, forward);
+    Mat b(3, 3, CV_64F, backward);
+    cv::getPerspectiveTransform(src, dst).copyTo(f);
+    cv::invert(f, b);
+    if (backward[8] != 0) {
+        for (int i = 0; i < 9; i++) {
+            backward[i] /= backward[8];
+        }
+    }
+
+    updateGL();
+    return true;
+}
+
+//---------------------------------------------------------
+bool Homography::set(const Point2f src[4], float dstWidth, float dstHeight) {
+    const Point2f rect[4] = {
+        Point2f(0, 0),
+        Point2f(dstWidth, 0),
+        Point2f(dstWidth, dstHeight),
+        Point2f(0, dstHeight)
+    };
+    return set(src, rect);
+}
+
+//---------------------------------------------------------
+Homography Homography::inverse() const {
+    Homography h(*this);
+    std::swap_ranges(h.src, h.src + 4, h.dst);
+    std::swap_ranges(h.forward, h.forward + 9, h.backward);
+    h.updateGL();
+    return h;
+}
+
+//---------------------------------------------------------
+void Homography::updateGL() {
+    // Homogeneous 2D into the x, y and w rows of a 4x4, leaving z alone
+    std::fill(gl, gl + 16, 0.0f);
+    gl[0]  = forward[0]; gl[4]  = forward[1]; gl[12] = forward[2];
+    gl[1]  = forward[3]; gl[5]  = forward[4]; gl[13] = forward[5];
+    gl[3]  = forward[6]; gl[7]  = forward[7]; gl[15] = forward[8];
+    gl[10] = 1;
+}
+
+//---------------------------------------------------------
+void Homography::apply(const double *h, const Point2f *in, Point2f *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        double x = in[i].x;
+        double y = in[i].y;
+        double w = h[6] * x + h[7] * y + h[8];
+        w = fabs(w) > FLT_EPSILON ? 1 / w : 0;
+        out[i] = Point2f((h[0] * x + h[1] * y + h[2]) * w,
+                         (h[3] * x + h[4] * y + h[5]) * w);
+    }
+}
+
+//---------------------------------------------------------
+ofPoint Homography::map(const ofPoint &p) const {
+    Point2f q = map(Point2f(p.x, p.y));
+    return ofPoint(q.x, q.y);
+}
+
+//---------------------------------------------------------
+Point2f Homography::map(const Point2f &p) const {
+    Point2f q;
+    apply(forward, &p, &q, 1);
+    return q;
+}
+
+//---------------------------------------------------------
+void Homography::map(const Point2f *in, Point2f *out, size_t n) const {
+    apply(forward, in, out, n);
+}
+
+//---------------------------------------------------------
+ofPoint Homography::unmap(const ofPoint &p) const {
+    Point2f q = unmap(Point2f(p.x, p.y));
+    return ofPoint(q.x, q.y);
+}
+
+//---------------------------------------------------------
+Point2f Homography::unmap(const Point2f &p) const {
+    Point2f q;
+    apply(backward, &p, &q, 1);
+    return q;
+}
+
+//---------------------------------------------------------
+void Homography::unmap(const Point2f *in, Point2f *out, size_t n) const {
+    apply(backward, in, out, n);
+}
+
+//---------------------------------------------------------
+Mat Homography::getMatrix() const {
+    return Mat(3, 3, CV_64F, (void *) forward);
+}
+
+//---------------------------------------------------------
+Mat Homography::getInverseMatrix() const {
+    return Mat(3, 3, CV_64F, (void *) backward);
+}
+
+//---------------------------------------------------------
+const float* Homography::getGLMatrix() const {
+    return gl;
+}
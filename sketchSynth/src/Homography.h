@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+/*
+ * A perspective transform between two quads, with its inverse and an OpenGL
+ * version of the matrix kept alongside. Setting the same quads again is
+ * free, and mapping points never allocates, so one of these can be asked
+ * for a transform every frame.
+ */
+class Homography {
+public:
+    Homography();
+
+    void setIdentity();
+
+    // Returns true if the quads changed and the matrices were recomputed
+    bool set(const cv::Point2f src[4], const cv::Point2f dst[4]);
+    bool set(const cv::Point2f src[4], float dstWidth, float dstHeight);
+
+    // Swaps the direction of the transform
+    Homography inverse() const;
+
+    ofPoint map(const ofPoint &p) const;
+    cv::Point2f map(const cv::Point2f &p) const;
+    void map(const cv::Point2f *in, cv::Point2f *out, size_t n) const;
+
+    ofPoint unmap(const ofPoint &p) const;
+    cv::Point2f unmap(const cv::Point2f &p) const;
+    void unmap(const cv::Point2f *in, cv::Point2f *out, size_t n) const;
+
+    // 3x3 CV_64F headers onto the cached matrices; don't write to them
+    cv::Mat getMatrix() const;
+    cv::Mat getInverseMatrix() const;
+
+    // Column major 4x4 matrix for glMultMatrixf
+    const float* getGLMatrix() const;
+
+private:
+    void updateGL();
+    static void apply(const double *h, const cv::Point2f *in, cv::Point2f *out, size_t n);
+
+    cv::Point2f src[4];
+    cv::Point2f dst[4];
+
+    double forward[9];
+    double backward[9];
+    float gl[16];
+};
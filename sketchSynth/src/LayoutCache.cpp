@@ -0,0 +1,216 @@
+#include "ofxXmlSettings.h"
+
+#include "LayoutCache.h"
+
+using cv::Mat;
+
+//---------------------------------------------------------
+SheetFingerprint::SheetFingerprint() {
+    for (int i = 0; i < words; i++) {
+        bits[i] = 0;
+    }
+}
+
+//---------------------------------------------------------
+void SheetFingerprint::compute(const Mat &unwarped) {
+    Mat gray, edges, cells;
+    ofxCv::convertColor(unwarped, gray, CV_RGB2GRAY);
+
+    // Edges are as thin at any resolution, so bigger images are brought down
+    // to the same size first to get the same fingerprint
+    if (gray.cols > width) {
+        cv::resize(gray, gray, cv::Size(width, cvRound(gray.rows * (float) width / gray.cols)), 0, 0, cv::INTER_AREA);
+    }
+    cv::Canny(gray, edges, 160, 180, 3);
+
+    // Leave out the edge of the paper itself, which every sheet has
+    int mx = edges.cols / 20;
+    int my = edges.rows / 20;
+    cv::Rect inside(mx, my, edges.cols - 2 * mx, edges.rows - 2 * my);
+    cv::resize(edges(inside), cells, cv::Size(cols, rows), 0, 0, cv::INTER_AREA);
+
+    // A cell has ink if more than a couple of percent of it is edges
+    for (int i = 0; i < words; i++) {
+        bits[i] = 0;
+    }
+    for (int y = 0; y < rows; y++) {
+        const uchar *c = cells.ptr<uchar>(y);
+        for (int x = 0; x < cols; x++) {
+            if (c[x] > 4) {
+                int i = y * cols + x;
+                bits[i / 64] |= (uint64_t) 1 << (i % 64);
+            }
+        }
+    }
+}
+
+//---------------------------------------------------------
+int SheetFingerprint::distance(const SheetFingerprint &other) const {
+    int d = 0;
+    for (int i = 0; i < words; i++) {
+        d += __builtin_popcountll(bits[i] ^ other.bits[i]);
+    }
+    return d;
+}
+
+//---------------------------------------------------------
+int SheetFingerprint::count() const {
+    int n = 0;
+    for (int i = 0; i < words; i++) {
+        n += __builtin_popcountll(bits[i]);
+    }
+    return n;
+}
+
+//---------------------------------------------------------
+string SheetFingerprint::toString() const {
+    string s;
+    char hex[17];
+    for (int i = 0; i < words; i++) {
+        snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) bits[i]);
+        s += hex;
+    }
+    return s;
+}
+
+//---------------------------------------------------------
+bool SheetFingerprint::fromString(const string &s) {
+    if (s.size() != (size_t) words * 16) {
+        return false;
+    }
+    for (int i = 0; i < words; i++) {
+        bits[i] = strtoull(s.substr(i * 16, 16).c_str(), NULL, 16);
+    }
+    return true;
+}
+
+//---------------------------------------------------------
+LayoutCache::LayoutCache()
+    : uses(0)
+{
+}
+
+//---------------------------------------------------------
+bool LayoutCache::load(const string &path) {
+    ofxXmlSettings xml;
+    if (!xml.loadFile(path)) {
+        return false;
+    }
+
+    entries.clear();
+    xml.pushTag("layouts");
+    int sheets = xml.getNumTags("sheet");
+    for (int i = 0; i < sheets; i++) {
+        xml.pushTag("sheet", i);
+
+        Entry entry;
+        entry.lastUsed = 0;
+        if (entry.fingerprint.fromString(xml.getValue("fingerprint", ""))) {
+            int controls = xml.getNumTags("control");
+            for (int c = 0; c < controls; c++) {
+                xml.pushTag("control", c);
+
+                ControlShape shape;
+                shape.type = (ControlType) xml.getValue("type", 0);
+                shape.id = xml.getValue("id", -1);
+                shape.rect.center.x = xml.getValue("x", 0.0);
+                shape.rect.center.y = xml.getValue("y", 0.0);
+                shape.rect.size.width = xml.getValue("width", 0.0);
+                shape.rect.size.height = xml.getValue("height", 0.0);
+                shape.rect.angle = xml.getValue("angle", 0.0);
+                entry.layout.push_back(shape);
+
+                xml.popTag();
+            }
+            entries.push_back(entry);
+        }
+
+        xml.popTag();
+    }
+    xml.popTag();
+    return true;
+}
+
+//---------------------------------------------------------
+bool LayoutCache::save(const string &path) {
+    ofxXmlSettings xml;
+    xml.addTag("layouts");
+    xml.pushTag("layouts");
+    for (size_t i = 0; i < entries.size(); i++) {
+        const Entry &entry = entries[i];
+        xml.addTag("sheet");
+        xml.pushTag("sheet", i);
+        xml.addValue("fingerprint", entry.fingerprint.toString());
+        for (size_t c = 0; c < entry.layout.size(); c++) {
+            const ControlShape &shape = entry.layout[c];
+            xml.addTag("control");
+            xml.pushTag("control", c);
+            xml.addValue("type", (int) shape.type);
+            xml.addValue("id", shape.id);
+            xml.addValue("x", shape.rect.center.x);
+            xml.addValue("y", shape.rect.center.y);
+            xml.addValue("width", shape.rect.size.width);
+            xml.addValue("height", shape.rect.size.height);
+            xml.addValue("angle", shape.rect.angle);
+            xml.popTag();
+        }
+        xml.popTag();
+    }
+    xml.popTag();
+
+    // TODO If ever upgraded beyond oF 0.700, this returns a boolean
+    xml.saveFile(path);
+    return true;
+}
+
+//---------------------------------------------------------
+bool LayoutCache::find(const SheetFingerprint &fingerprint, vector<ControlShape> &layout) {
+    int i = findEntry(fingerprint);
+    if (i < 0) {
+        return false;
+    }
+    entries[i].lastUsed = ++uses;
+    layout = entries[i].layout;
+    return true;
+}
+
+//---------------------------------------------------------
+void LayoutCache::store(const SheetFingerprint &fingerprint, const vector<ControlShape> &layout) {
+    int i = findEntry(fingerprint);
+    if (i < 0) {
+        // Make room by forgetting the sheet that's gone longest unused
+        if (entries.size() >= maxEntries) {
+            size_t oldest = 0;
+            for (size_t e = 1; e < entries.size(); e++) {
+                if (entries[e].lastUsed < entries[oldest].lastUsed) {
+                    oldest = e;
+                }
+            }
+            entries.erase(entries.begin() + oldest);
+        }
+        entries.push_back(Entry());
+        i = entries.size() - 1;
+    }
+
+    Entry &entry = entries[i];
+    entry.fingerprint = fingerprint;
+    entry.layout = layout;
+    entry.lastUsed = ++uses;
+}
+
+//---------------------------------------------------------
+int LayoutCache::findEntry(const SheetFingerprint &fingerprint) {
+    // Allow a few cells to flip for every few with ink in them
+    int best = -1;
+    int bestDistance = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const SheetFingerprint &other = entries[i].fingerprint;
+        int d = fingerprint.distance(other);
+        int allowed = 2 + max(fingerprint.count(), other.count()) / 8;
+        if (d <= allowed && (best < 0 || d < bestDistance)) {
+            best = i;
+            bestDistance = d;
+        }
+    }
+    return best;
+}
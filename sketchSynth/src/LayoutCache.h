@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "Control.h"
+
+/*
+ * A rough picture of what's drawn on a sheet: the unwarped image is cut
+ * into a grid, and each cell's bit says whether it has any ink in it. The
+ * same sheet gives nearly the same bits wherever it lies on the table and
+ * whatever the lighting, and a sheet with a control added or erased
+ * doesn't.
+ */
+struct SheetFingerprint {
+    SheetFingerprint();
+
+    void compute(const cv::Mat &unwarped);
+
+    // Number of cells that differ
+    int distance(const SheetFingerprint &other) const;
+    int count() const;
+
+    string toString() const;
+    bool fromString(const string &s);
+
+    static const int cols = 16;
+    static const int rows = 16;
+    static const int words = cols * rows / 64;
+    static const int width = 518;
+    uint64_t bits[words];
+};
+
+/*
+ * Control layouts of sheets that have been seen before, so a sheet that's
+ * put back skips control detection. Kept in memory and in an XML file in
+ * the data folder, so it also survives a restart.
+ */
+class LayoutCache {
+public:
+    LayoutCache();
+
+    bool load(const string &path);
+    bool save(const string &path);
+
+    // The layout of the closest sheet, if it's close enough
+    bool find(const SheetFingerprint &fingerprint, vector<ControlShape> &layout);
+
+    // Replaces the layout of a sheet that matches, or adds a new one
+    void store(const SheetFingerprint &fingerprint, const vector<ControlShape> &layout);
+
+private:
+    struct Entry {
+        SheetFingerprint fingerprint;
+        vector<ControlShape> layout;
+        unsigned long lastUsed;
+    };
+
+    int findEntry(const SheetFingerprint &fingerprint);
+
+    vector<Entry> entries;
+    unsigned long uses;
+
+    static const size_t maxEntries = 32;
+};
@@ -0,0 +1,214 @@
+#include <string.h>
+
+#include "OscEncoder.h"
+
+namespace {
+    enum Prefix { STOP, START, COUNT, CONTINUOUS_VALUE, TOGGLE_VALUE, MOMENTARY_VALUE };
+
+    const char on[4] = { 'o', 'n', 0, 0 };
+    const char off[4] = { 'o', 'f', 'f', 0 };
+    const char continuous[12] = { 'c', 'o', 'n', 't', 'i', 'n', 'u', 'o', 'u', 's', 0, 0 };
+    const char toggle[8] = { 't', 'o', 'g', 'g', 'l', 'e', 0, 0 };
+    const char momentary[12] = { 'm', 'o', 'm', 'e', 'n', 't', 'a', 'r', 'y', 0, 0, 0 };
+}
+
+//---------------------------------------------------------
+OscEncoder::OscEncoder()
+    : size(0)
+    , messageStart(0)
+    , inBundle(false)
+{
+    setNamespace("/paper");
+}
+
+//---------------------------------------------------------
+void OscEncoder::setNamespace(const char *ns) {
+    char cut[maxNamespace + 1];
+    strncpy(cut, ns, maxNamespace);
+    cut[maxNamespace] = 0;
+
+    setPrefix(STOP, cut, "/stop", ",");
+    setPrefix(START, cut, "/start", ",");
+    setPrefix(COUNT, cut, "/count", ",si");
+    setPrefix(CONTINUOUS_VALUE, cut, "/continuous", ",if");
+    setPrefix(TOGGLE_VALUE, cut, "/toggle", ",is");
+    setPrefix(MOMENTARY_VALUE, cut, "/momentary", ",is");
+}
+
+//---------------------------------------------------------
+void OscEncoder::setPrefix(int prefix, const char *ns, const char *name, const char *tags) {
+    // The address is written in two parts and padded once, then the tags
+    size_t n = strlen(ns);
+    size_t m = strlen(name);
+    size_t padded = (n + m + 4) & ~(size_t) 3;
+    char *p = prefixBytes[prefix];
+    memset(p, 0, padded);
+    memcpy(p, ns, n);
+    memcpy(p + n, name, m);
+    prefixSize[prefix] = padded;
+    appendPrefix(prefix, tags, strlen(tags));
+}
+
+//---------------------------------------------------------
+void OscEncoder::appendPrefix(int prefix, const char *s, size_t n) {
+    size_t padded = (n + 4) & ~(size_t) 3;
+    char *p = prefixBytes[prefix] + prefixSize[prefix];
+    memset(p, 0, padded);
+    memcpy(p, s, n);
+    prefixSize[prefix] += padded;
+}
+
+//---------------------------------------------------------
+void OscEncoder::clear() {
+    size = 0;
+    inBundle = false;
+}
+
+//---------------------------------------------------------
+void OscEncoder::beginBundle(uint64_t timeTag) {
+    write("#bundle", 8);
+    writeInt(timeTag >> 32);
+    writeInt(timeTag & 0xffffffff);
+    inBundle = true;
+}
+
+//---------------------------------------------------------
+void OscEncoder::endBundle() {
+    inBundle = false;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::isBundleInProgress() const {
+    return inBundle;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::addStop() {
+    if (!begin(STOP)) {
+        return false;
+    }
+    end();
+    return true;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::addStart() {
+    if (!begin(START)) {
+        return false;
+    }
+    end();
+    return true;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::addCount(ControlType type, int count) {
+    if (!begin(COUNT)) {
+        return false;
+    }
+    switch (type) {
+        case CONTINUOUS:
+            write(continuous, sizeof(continuous));
+            break;
+        case TOGGLE:
+            write(toggle, sizeof(toggle));
+            break;
+        case MOMENTARY:
+            write(momentary, sizeof(momentary));
+            break;
+    }
+    writeInt(count);
+    end();
+    return true;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::addContinuous(int id, float value) {
+    if (!begin(CONTINUOUS_VALUE)) {
+        return false;
+    }
+    uint32_t bits;
+    memcpy(&bits, &value, 4);
+    writeInt(id);
+    writeInt(bits);
+    end();
+    return true;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::addToggle(int id, bool state) {
+    if (!begin(TOGGLE_VALUE)) {
+        return false;
+    }
+    writeInt(id);
+    write(state ? on : off, 4);
+    end();
+    return true;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::addMomentary(int id, bool state) {
+    if (!begin(MOMENTARY_VALUE)) {
+        return false;
+    }
+    writeInt(id);
+    write(state ? on : off, 4);
+    end();
+    return true;
+}
+
+//---------------------------------------------------------
+const char* OscEncoder::getData() const {
+    return buffer;
+}
+
+//---------------------------------------------------------
+size_t OscEncoder::getSize() const {
+    return size;
+}
+
+//---------------------------------------------------------
+size_t OscEncoder::getRemaining() const {
+    return capacity - size;
+}
+
+//---------------------------------------------------------
+bool OscEncoder::begin(int prefix) {
+    if (getRemaining() < maxMessageSize) {
+        return false;
+    }
+
+    // Inside a bundle, each message starts with its size, filled in by end()
+    messageStart = size;
+    if (inBundle) {
+        size += 4;
+    }
+    write(prefixBytes[prefix], prefixSize[prefix]);
+    return true;
+}
+
+//---------------------------------------------------------
+void OscEncoder::end() {
+    if (inBundle) {
+        size_t end = size;
+        size = messageStart;
+        writeInt(end - messageStart - 4);
+        size = end;
+    }
+}
+
+//---------------------------------------------------------
+void OscEncoder::write(const char *bytes, size_t n) {
+    memcpy(buffer + size, bytes, n);
+    size += n;
+}
+
+//---------------------------------------------------------
+void OscEncoder::writeInt(uint32_t value) {
+    // OSC is big endian
+    char *p = buffer + size;
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+    size += 4;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum ControlType { CONTINUOUS, TOGGLE, MOMENTARY };
+
+/*
+ * Writes the /paper/* messages straight into a fixed buffer, producing the
+ * same bytes oscpack does for them. The address and type tags of each kind
+ * of message are encoded once up front, so a message is a copy of that
+ * prefix and then its arguments, with no allocation and nothing to parse.
+ *
+ * Messages are always written inside a bundle, which is how ofxOsc sent
+ * them too. Each add*() returns false, leaving the buffer as it was, if the
+ * message doesn't fit.
+ */
+class OscEncoder {
+public:
+    OscEncoder();
+
+    // Addresses start with this instead of /paper, cut to maxNamespace
+    // characters
+    void setNamespace(const char *ns);
+    static const size_t maxNamespace = 16;
+
+    void clear();
+
+    // A time tag of 1 means "immediately"
+    void beginBundle(uint64_t timeTag = 1);
+    void endBundle();
+    bool isBundleInProgress() const;
+
+    bool addStop();
+    bool addStart();
+    bool addCount(ControlType type, int count);
+    bool addContinuous(int id, float value);
+    bool addToggle(int id, bool state);
+    bool addMomentary(int id, bool on);
+
+    const char* getData() const;
+    size_t getSize() const;
+
+    // Bytes left, and the most any one message (with its size) takes
+    size_t getRemaining() const;
+    static const size_t maxMessageSize = 48;
+
+private:
+    void setPrefix(int prefix, const char *ns, const char *name, const char *tags);
+    void appendPrefix(int prefix, const char *s, size_t n);
+
+    bool begin(int prefix);
+    void end();
+    void write(const char *bytes, size_t n);
+    void writeInt(uint32_t value);
+
+    // Address and type tags of each message, each null terminated and
+    // padded to four bytes
+    static const int numPrefixes = 6;
+    char prefixBytes[numPrefixes][32];
+    size_t prefixSize[numPrefixes];
+
+    static const size_t capacity = 8192;
+    char buffer[capacity];
+    size_t size;
+    size_t messageStart;
+    bool inBundle;
+};
@@ -1,68 +1,440 @@
-#include "ofMain.h"
+#include <math.h>
+#include <sys/time.h>
+
+#include "UdpSocket.h"
 
 #include "OscSender.h"
+#include "Profiler.h"
+
+//---------------------------------------------------------
+OscSender::OscSender()
+    : bundling(true)
+    , bundleDelay(-1)
+    , epsilon(0.002)
+    , minInterval(33)
+    , inBundle(false)
+    , batch(1)
+    , events(256)
+    , values(1024)
+    , released(0)
+    , overflowed(0)
+    , coalesced(0)
+    , deferred(0)
+    , throttleUntil(0)
+    , socket(NULL)
+{
+}
+
+//---------------------------------------------------------
+OscSender::~OscSender() {
+    stop();
+    delete socket;
+}
 
 //---------------------------------------------------------
 void OscSender::setup(string host, int port) {
-    sender.setup(host, port);
+    stop();
+    delete socket;
+    socket = new UdpTransmitSocket(IpEndpointName(host.c_str(), port));
+    startThread(true, false);
+}
+
+//---------------------------------------------------------
+void OscSender::stop() {
+    if (!isThreadRunning()) {
+        return;
+    }
+
+    // Anything still waiting for room goes out before the thread does
+    while (!backlog.empty() || !overflow.empty()) {
+        release();
+        ofSleepMillis(1);
+    }
+    stopThread();
+    wake.set();
+    waitForThread(false);
+}
+
+//---------------------------------------------------------
+void OscSender::setNamespace(const string &ns) {
+    encoder.setNamespace(ns.c_str());
+}
+
+//---------------------------------------------------------
+void OscSender::setBundling(bool b) {
+    bundling = b;
+}
+
+//---------------------------------------------------------
+void OscSender::setBundleDelay(int ms) {
+    bundleDelay = ms;
+}
+
+//---------------------------------------------------------
+void OscSender::setEpsilon(float e) {
+    epsilon = e;
+}
+
+//---------------------------------------------------------
+void OscSender::setRateLimit(float perSecond) {
+    minInterval = perSecond > 0 ? 1000 / perSecond : 0;
+}
+
+//---------------------------------------------------------
+void OscSender::beginBundle() {
+    inBundle = true;
+}
+
+//---------------------------------------------------------
+void OscSender::endBundle() {
+    if (!inBundle) {
+        return;
+    }
+    inBundle = false;
+
+    for (size_t i = 0; i < pending.size(); i++) {
+        const Message &m = pending[i];
+        if (m.kind == VALUE && m.type == CONTINUOUS) {
+            pendingContinuous[m.id] = -1;
+        }
+        enqueue(m);
+    }
+    pending.clear();
+    release();
 }
 
 //---------------------------------------------------------
 void OscSender::sendStopAll() {
-    ofxOscMessage m;
-    m.setAddress("/paper/stop");
-    sender.sendMessage(m);
+    Message m;
+    m.kind = STOP;
+    send(m);
 }
 
 //---------------------------------------------------------
 void OscSender::sendStartAll() {
-    ofxOscMessage m;
-    m.setAddress("/paper/start");
-    sender.sendMessage(m);
+    Message m;
+    m.kind = START;
+    send(m);
 }
 
 //---------------------------------------------------------
 void OscSender::sendControlCount(ControlType type, int count) {
-    ofxOscMessage m;
-    m.setAddress("/paper/count");
-    switch (type) {
-        case CONTINUOUS:
-            m.addStringArg("continuous");
-            break;
-        case TOGGLE:
-            m.addStringArg("toggle");
-            break;
-        case MOMENTARY:
-            m.addStringArg("momentary");
-            break;
-    }
-    m.addIntArg(count);
-    sender.sendMessage(m);
+    Message m;
+    m.kind = COUNT;
+    m.type = type;
+    m.id = count;
+    send(m);
 }
 
 //---------------------------------------------------------
 void OscSender::sendContinuousValue(int id, float value) {
-    ofxOscMessage m;
-    m.setAddress("/paper/continuous");
-    m.addIntArg(id);
-    m.addFloatArg(value);
-    sender.sendMessage(m);
+    if (id < 0) {
+        return;
+    }
+
+    // Only the last value in a batch matters
+    if (inBundle) {
+        if ((size_t) id >= pendingContinuous.size()) {
+            pendingContinuous.resize(id + 1, -1);
+        }
+        int &at = pendingContinuous[id];
+        if (at >= 0) {
+            pending[at].value = value;
+            __sync_fetch_and_add(&coalesced, 1);
+            return;
+        }
+        at = pending.size();
+    }
+
+    Message m;
+    m.kind = VALUE;
+    m.type = CONTINUOUS;
+    m.id = id;
+    m.value = value;
+    send(m);
 }
 
 //---------------------------------------------------------
 void OscSender::sendToggleValue(int id, bool state) {
-    ofxOscMessage m;
-    m.setAddress("/paper/toggle");
-    m.addIntArg(id);
-    m.addStringArg(state ? "on" : "off");
-    sender.sendMessage(m);
+    Message m;
+    m.kind = VALUE;
+    m.type = TOGGLE;
+    m.id = id;
+    m.value = state;
+    send(m);
 }
 
 //---------------------------------------------------------
 void OscSender::sendMomentaryValue(int id, bool on) {
-    ofxOscMessage m;
-    m.setAddress("/paper/momentary");
-    m.addIntArg(id);
-    m.addStringArg(on ? "on" : "off");
-    sender.sendMessage(m);
+    Message m;
+    m.kind = VALUE;
+    m.type = MOMENTARY;
+    m.id = id;
+    m.value = on;
+    send(m);
+}
+
+//---------------------------------------------------------
+size_t OscSender::getQueueDepth() {
+    return events.size() + values.size();
+}
+
+//---------------------------------------------------------
+unsigned long OscSender::getOverflowCount() {
+    return overflowed;
+}
+
+//---------------------------------------------------------
+unsigned long OscSender::getCoalescedCount() {
+    return coalesced;
+}
+
+//---------------------------------------------------------
+unsigned long OscSender::getDeferredCount() {
+    return deferred;
+}
+
+//---------------------------------------------------------
+void OscSender::send(const Message &m) {
+    if (inBundle) {
+        pending.push_back(m);
+    } else {
+        enqueue(m);
+        release();
+    }
+}
+
+//---------------------------------------------------------
+void OscSender::enqueue(Message m) {
+    m.batch = batch;
+    if (m.kind == VALUE && m.type == CONTINUOUS) {
+        // A slider that stops moving doesn't send again, so its last value
+        // can't be lost either. Only the latest one needs to wait, though.
+        if ((size_t) m.id >= overflowAt.size()) {
+            overflowAt.resize(m.id + 1, -1);
+        }
+        int &at = overflowAt[m.id];
+        if (at >= 0) {
+            overflow[at] = m;
+            __sync_fetch_and_add(&coalesced, 1);
+        } else if (!values.push(m)) {
+            at = overflow.size();
+            overflow.push_back(m);
+            __sync_fetch_and_add(&overflowed, 1);
+        }
+        return;
+    }
+
+    // A lost button release or switch change would leave the patch wrong,
+    // so events that don't fit wait their turn instead
+    if (!backlog.empty() || !events.push(m)) {
+        backlog.push_back(m);
+    }
+}
+
+//---------------------------------------------------------
+void OscSender::drainBacklog() {
+    size_t n = 0;
+    while (n < backlog.size() && events.push(backlog[n])) {
+        n++;
+    }
+    backlog.erase(backlog.begin(), backlog.begin() + n);
+}
+
+//---------------------------------------------------------
+void OscSender::drainOverflow() {
+    size_t n = 0;
+    while (n < overflow.size() && values.push(overflow[n])) {
+        overflowAt[overflow[n].id] = -1;
+        n++;
+    }
+    overflow.erase(overflow.begin(), overflow.begin() + n);
+    for (size_t i = 0; i < overflow.size(); i++) {
+        overflowAt[overflow[i].id] = i;
+    }
+}
+
+//---------------------------------------------------------
+void OscSender::release() {
+    if (!backlog.empty()) {
+        drainBacklog();
+    }
+    if (!overflow.empty()) {
+        drainOverflow();
+    }
+
+    // A batch can only go out once all its events are in the queue
+    unsigned long ready = backlog.empty() ? batch : backlog.front().batch - 1;
+    batch++;
+    __sync_synchronize();
+    if (ready != released) {
+        released = ready;
+        wake.set();
+    }
+}
+
+//---------------------------------------------------------
+void OscSender::threadedFunction() {
+    while (isThreadRunning()) {
+        if (!process()) {
+            // Until the next release, or until a slider the rate limit held
+            // back is due
+            wake.tryWait(waiting.empty() ? maxIdle : max(minInterval, 1));
+        }
+    }
+
+    // Don't lose anything sent right before stopping, like /paper/stop
+    // on exit
+    minInterval = 0;
+    process();
+}
+
+//---------------------------------------------------------
+bool OscSender::process() {
+    unsigned long ready = released;
+    __sync_synchronize();
+
+    // Only a real backlog throttles. Several releases in a row, like the
+    // counts sent one by one at a layout change, are nothing to worry about.
+    unsigned long long now = ofGetElapsedTimeMillis();
+    if (events.size() > events.capacity() / 2 || values.size() > values.capacity() / 2) {
+        throttleUntil = now + 1000;
+    }
+    bool throttle = now < throttleUntil;
+
+    // Events first, in order
+    Message m;
+    outEvents.clear();
+    while (events.peek(m) && m.batch <= ready) {
+        events.pop();
+        if (m.kind == COUNT && m.type == CONTINUOUS) {
+            // A new set of sliders, so nothing has been sent for them yet
+            sliders.assign(m.id, SliderState());
+            waiting.clear();
+        }
+        outEvents.push_back(m);
+    }
+
+    // Then the latest value of each slider
+    while (values.peek(m) && m.batch <= ready) {
+        values.pop();
+        if ((size_t) m.id >= sliders.size()) {
+            sliders.resize(m.id + 1);
+        }
+        SliderState &s = sliders[m.id];
+        if (s.waiting) {
+            __sync_fetch_and_add(&coalesced, 1);
+        } else {
+            s.waiting = true;
+            waiting.push_back(m.id);
+        }
+        s.value = m.value;
+    }
+
+    outValues.clear();
+    size_t kept = 0;
+    for (size_t i = 0; i < waiting.size(); i++) {
+        SliderState &s = sliders[waiting[i]];
+        if (throttle && now - s.sentTime < (unsigned long long) minInterval) {
+            waiting[kept++] = waiting[i];
+            __sync_fetch_and_add(&deferred, 1);
+            continue;
+        }
+        s.waiting = false;
+        if (fabs(s.value - s.sent) < epsilon) {
+            continue;
+        }
+        s.sent = s.value;
+        s.sentTime = now;
+        outValues.push_back(waiting[i]);
+    }
+    waiting.resize(kept);
+
+    if (outEvents.empty() && outValues.empty()) {
+        return false;
+    }
+
+    PROFILE_SCOPE(PROFILE_OSC_SEND);
+    encoder.clear();
+    if (bundling) {
+        encoder.beginBundle(getTimeTag());
+    }
+    for (size_t i = 0; i < outEvents.size() + outValues.size(); i++) {
+        if (!bundling) {
+            // ofxOsc wrapped every message in a bundle of its own, so
+            // receivers see exactly what they used to
+            encoder.beginBundle();
+        } else if (encoder.getRemaining() < OscEncoder::maxMessageSize) {
+            // Too much for one datagram, so start another bundle
+            flush();
+            encoder.beginBundle(getTimeTag());
+        }
+
+        if (i < outEvents.size()) {
+            write(outEvents[i]);
+        } else {
+            int id = outValues[i - outEvents.size()];
+            encoder.addContinuous(id, sliders[id].value);
+        }
+
+        if (!bundling) {
+            flush();
+        }
+    }
+    if (bundling) {
+        flush();
+    }
+    return true;
+}
+
+//---------------------------------------------------------
+void OscSender::write(const Message &m) {
+    switch (m.kind) {
+        case STOP:
+            encoder.addStop();
+            break;
+        case START:
+            encoder.addStart();
+            break;
+        case COUNT:
+            encoder.addCount(m.type, m.id);
+            break;
+        case VALUE:
+            switch (m.type) {
+                case CONTINUOUS:
+                    encoder.addContinuous(m.id, m.value);
+                    break;
+                case TOGGLE:
+                    encoder.addToggle(m.id, m.value);
+                    break;
+                case MOMENTARY:
+                    encoder.addMomentary(m.id, m.value);
+                    break;
+            }
+            break;
+    }
+}
+
+//---------------------------------------------------------
+void OscSender::flush() {
+    encoder.endBundle();
+    if (socket != NULL) {
+        socket->Send(encoder.getData(), encoder.getSize());
+    }
+    encoder.clear();
+}
+
+//---------------------------------------------------------
+uint64_t OscSender::getTimeTag() {
+    if (bundleDelay < 0) {
+        return 1;
+    }
+
+    // NTP time: seconds since 1900 in the high word, fraction in the low
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    uint64_t usec = (uint64_t) tv.tv_usec + bundleDelay * 1000;
+    uint64_t sec = (uint64_t) tv.tv_sec + 2208988800UL + usec / 1000000;
+    usec %= 1000000;
+    return (sec << 32) | ((usec << 32) / 1000000);
 }
@@ -1,16 +1,67 @@
 #pragma once
 
-#include "ofxOsc.h"
+#include "ofMain.h"
+#include "Poco/Event.h"
+
+#include "OscEncoder.h"
+#include "SpscQueue.h"
 
 #define DEFAULT_HOST "localhost"
 #define DEFAULT_PORT 12345
 
-enum ControlType { CONTINUOUS, TOGGLE, MOMENTARY };
+class UdpTransmitSocket;
 
-class OscSender {
+/*
+ * Sends the /paper/* messages from a thread of its own, so a slow or
+ * blocked socket never holds up the caller.
+ *
+ * Messages are handed over through two lock-free queues: one for button and
+ * switch events and the control counts, which go out first and are never
+ * merged or dropped, and one for slider values. Events that don't fit wait
+ * on the caller's side, holding back the batches after them, until there's
+ * room. Slider values that don't fit wait there too, one per slider, with a
+ * newer value replacing the one waiting. Nothing is ever dropped. The
+ * output thread sleeps until a batch is released and then sends
+ * everything that's ready as one timetagged bundle. A slider that
+ * moved several times only sends its last value, and values within the
+ * epsilon of what was last sent for that slider aren't sent at all. If the
+ * queues fill up past half, sliders are also held to a maximum rate for a
+ * while.
+ *
+ * Everything sent between beginBundle() and endBundle() is released to the
+ * output thread together, so it ends up in the same bundle.
+ */
+class OscSender : public ofThread {
 public:
+    OscSender();
+    ~OscSender();
+
+    // Starts the output thread; configure before calling
     void setup(string host = DEFAULT_HOST, int port = DEFAULT_PORT);
 
+    // Messages go to /paper/* unless this is changed, like to /paper/1/*
+    // for the second of several sheets
+    void setNamespace(const string &ns);
+
+    // Sends whatever is left and stops the output thread
+    void stop();
+
+    // With bundling off every message is sent in a bundle of its own, like
+    // ofxOsc does
+    void setBundling(bool bundling);
+
+    // Bundles are timetagged this many milliseconds after they're sent, so
+    // the receiver can play them back evenly. Negative, the default, means
+    // immediately.
+    void setBundleDelay(int ms);
+    void setEpsilon(float epsilon);
+
+    // Values per second each slider is held to while the queues are backed up
+    void setRateLimit(float perSecond);
+
+    void beginBundle();
+    void endBundle();
+
     void sendStopAll();
     void sendStartAll();
     void sendControlCount(ControlType type, int count);
@@ -19,6 +70,94 @@ public:
     void sendToggleValue(int id, bool state);
     void sendMomentaryValue(int id, bool on);
 
+    // Messages waiting for the output thread
+    size_t getQueueDepth();
+    // Slider values that found their queue full and waited for room
+    unsigned long getOverflowCount();
+    // Slider values replaced by a newer one before they were sent
+    unsigned long getCoalescedCount();
+    // Slider values held back by the rate limit
+    unsigned long getDeferredCount();
+
+protected:
+    void threadedFunction();
+
 private:
-    ofxOscSender sender;
+    OscSender(const OscSender &);
+    OscSender& operator=(const OscSender &);
+
+    enum Kind { STOP, START, COUNT, VALUE };
+
+    struct Message {
+        Message() : kind(STOP), type(CONTINUOUS), id(0), value(0), batch(0) {}
+
+        Kind kind;
+        ControlType type;
+        int id;
+        float value;
+        // Which release the message belongs to
+        unsigned long batch;
+    };
+
+    // The output thread's view of one slider
+    struct SliderState {
+        SliderState() : waiting(false), value(0), sent(NAN), sentTime(0) {}
+
+        bool waiting;
+        float value;
+        float sent;
+        unsigned long long sentTime;
+    };
+
+    // Caller side
+    void send(const Message &m);
+    void enqueue(Message m);
+    void drainBacklog();
+    void drainOverflow();
+    void release();
+
+    // Output thread side
+    bool process();
+    void write(const Message &m);
+    void flush();
+    uint64_t getTimeTag();
+
+    bool bundling;
+    int bundleDelay;
+    float epsilon;
+    int minInterval;
+
+    // Caller side: the current batch, with sliders merged as they come in
+    bool inBundle;
+    vector<Message> pending;
+    vector<int> pendingContinuous;
+    unsigned long batch;
+    // Events that didn't fit in the queue yet, oldest first
+    vector<Message> backlog;
+    // The latest slider values that didn't fit, and where each slider's is
+    vector<Message> overflow;
+    vector<int> overflowAt;
+
+    SpscQueue<Message> events;
+    SpscQueue<Message> values;
+    // The last batch that's completely in the queues
+    volatile unsigned long released;
+    // Set on each release, and waited on by the output thread
+    Poco::Event wake;
+    // Longest the output thread sleeps without being woken
+    static const int maxIdle = 100;
+
+    volatile unsigned long overflowed;
+    volatile unsigned long coalesced;
+    volatile unsigned long deferred;
+
+    // Output thread side
+    vector<SliderState> sliders;
+    vector<int> waiting;
+    vector<Message> outEvents;
+    vector<int> outValues;
+    unsigned long long throttleUntil;
+
+    UdpTransmitSocket *socket;
+    OscEncoder encoder;
 };
@@ -6,21 +6,177 @@ using ofxCv::toOf;
 using cv::Mat;
 using cv::Point2f;
 
+namespace {
+    // Tracked corners must still look like this much of their reference patch
+    const float minCornerScore = 0.6;
+
+    // Tracking fails if the paper grows or shrinks more than this
+    const float maxAreaChange = 0.2;
+
+    void toGray(const Mat &src, Mat &dst) {
+        if (src.channels() == 1) {
+            src.copyTo(dst);
+        } else {
+            cv::cvtColor(src, dst, CV_RGB2GRAY);
+        }
+    }
+
+    ofPolyline toPolyline(const vector<Point2f> &quad) {
+        ofPolyline poly;
+        for (size_t i = 0; i < quad.size(); i++) {
+            poly.addVertex(quad[i].x, quad[i].y);
+        }
+        return poly;
+    }
+}
+
+PaperDetector::PaperDetector()
+    : nextSlot(0)
+    , tracking(false)
+    , locked(false)
+    , confidence(0)
+    , lockedArea(0)
+    , flowIn(1)
+    , flowOut(1)
+{
+}
+
 void PaperDetector::setup() {
 	finder.setMinAreaRadius(50);
 	finder.setMaxAreaRadius(200);
 	finder.setThreshold(120);
 }
 
+void PaperDetector::reset() {
+    locked = false;
+    confidence = 0;
+}
+
 void PaperDetector::draw() {
-    if (paper.size() == 4) {
+    draw(paper);
+}
+
+void PaperDetector::draw(const vector<cv::Point> &quad) {
+    if (quad.size() == 4) {
         ofNoFill();
         ofSetColor(ofxCv::magentaPrint);
-        ofxCv::toOf(paper).draw();
+        ofxCv::toOf(quad).draw();
+    }
+}
+
+void PaperDetector::setTracking(bool track) {
+    tracking = track;
+    if (!tracking) {
+        reset();
     }
 }
 
+bool PaperDetector::isTracking() {
+    return locked;
+}
+
+float PaperDetector::getConfidence() {
+    return confidence;
+}
+
 bool PaperDetector::detect(cv::Mat img) {
+    if (follow(img)) {
+        return true;
+    }
+
+    bool found = findPaper(img);
+    if (found && tracking) {
+        lock(img);
+    }
+    return found;
+}
+
+bool PaperDetector::follow(cv::Mat img) {
+    if (locked) {
+        if (track(img)) {
+            paperImage = img;
+            return true;
+        }
+        locked = false;
+    }
+    return false;
+}
+
+void PaperDetector::findCandidates(cv::Mat img, vector< vector<cv::Point> > &quads) {
+    finder.findContours(img);
+
+    const size_t n = finder.size();
+    vector< vector<cv::Point> > found;
+    areas.clear();
+    for (size_t i = 0; i < n; i++) {
+        vector<cv::Point> quad = finder.getFitQuad(i);
+        if (ShapeUtils::isRectangle(quad)) {
+            areas.push_back(make_pair(-fabs(ShapeUtils::polylineArea(toOf(quad))), found.size()));
+            found.push_back(quad);
+        }
+    }
+    std::sort(areas.begin(), areas.end());
+
+    quads.resize(areas.size());
+    for (size_t i = 0; i < areas.size(); i++) {
+        quads[i].swap(found[areas[i].second]);
+    }
+}
+
+bool PaperDetector::claim(cv::Mat img, vector< vector<cv::Point> > &candidates) {
+    size_t pick = 0;
+    if (hasPaper()) {
+        // Only the same sheet, if it's still about where it was
+        Point2f center = getCenter();
+        for (pick = 0; pick < candidates.size(); pick++) {
+            if (cv::pointPolygonTest(Mat(candidates[pick]), center, false) >= 0) {
+                break;
+            }
+        }
+    }
+    if (pick >= candidates.size()) {
+        return false;
+    }
+    take(img, candidates, pick);
+    return true;
+}
+
+void PaperDetector::take(cv::Mat img, vector< vector<cv::Point> > &candidates, size_t pick) {
+    paperImage = img;
+    setPaper(vector<Point2f>(candidates[pick].begin(), candidates[pick].end()));
+    candidates.erase(candidates.begin() + pick);
+    if (tracking) {
+        lock(img);
+    }
+}
+
+void PaperDetector::forget() {
+    reset();
+    corners.clear();
+    paper.clear();
+}
+
+bool PaperDetector::hasPaper() {
+    return corners.size() == 4;
+}
+
+Point2f PaperDetector::getCenter() {
+    Point2f center;
+    for (size_t i = 0; i < corners.size(); i++) {
+        center += corners[i];
+    }
+    return corners.empty() ? center : center * (1.0f / corners.size());
+}
+
+float PaperDetector::getReach() {
+    float longest = 0;
+    for (size_t i = 0; i < corners.size(); i++) {
+        longest = max(longest, (float) cv::norm(corners[(i + 1) % corners.size()] - corners[i]));
+    }
+    return longest / 2;
+}
+
+bool PaperDetector::findPaper(cv::Mat img) {
     finder.findContours(img);
 
     vector<cv::Point> maxQuad;
@@ -42,46 +198,164 @@ bool PaperDetector::detect(cv::Mat img) {
     bool isRect = ShapeUtils::isRectangle(maxQuad);
     if (isRect) {
         paperImage = img;
-        paper = maxQuad;
+        setPaper(vector<Point2f>(maxQuad.begin(), maxQuad.end()));
     }
     return isRect;
 }
 
-Mat PaperDetector::getTransformation(int outWidth, int outHeight) {
-    vector<Point2f> warpPoints;
-    copy(paper.begin(), paper.end(), back_inserter(warpPoints));
-    ShapeUtils::orderQuadForTransform(warpPoints);
+void PaperDetector::setPaper(const vector<Point2f> &quad) {
+    corners = quad;
+    paper.resize(quad.size());
+    for (size_t i = 0; i < quad.size(); i++) {
+        paper[i] = cv::Point(cvRound(quad[i].x), cvRound(quad[i].y));
+    }
+}
+
+cv::Rect PaperDetector::cornerWindow(const Point2f &corner, int radius, const cv::Size &size) {
+    cv::Rect window(cvRound(corner.x) - radius, cvRound(corner.y) - radius, 2 * radius + 1, 2 * radius + 1);
+    return window & cv::Rect(0, 0, size.width, size.height);
+}
+
+void PaperDetector::lock(const Mat &img) {
+    const int radius = searchRadius + patchRadius;
+    const cv::Size patchSize(2 * patchRadius + 1, 2 * patchRadius + 1);
+
+    // Remember what each corner looks like now, so we can tell when it's
+    // covered by a hand later on
+    for (int i = 0; i < 4; i++) {
+        Corner &c = tracked[i];
+        c.locked = corners[i];
+        c.window = cornerWindow(corners[i], radius, img.size());
+        toGray(img(c.window), c.previous);
 
-    vector<Point2f> dstPoints(4);
-    dstPoints[0] = Point2f(0, 0);
-    dstPoints[1] = Point2f(outWidth, 0);
-    dstPoints[2] = Point2f(outWidth, outHeight);
-    dstPoints[3] = Point2f(0, outHeight);
+        cv::Rect patch(cv::Point(cvRound(corners[i].x) - patchRadius, cvRound(corners[i].y) - patchRadius) - c.window.tl(), patchSize);
+        if ((patch & cv::Rect(0, 0, c.window.width, c.window.height)) != patch) {
+            // Too close to the edge of the frame to track
+            return;
+        }
+        c.previous(patch).copyTo(c.reference);
+    }
 
-    return cv::getPerspectiveTransform(&dstPoints[0], &warpPoints[0]);
+    lockedArea = fabs(ShapeUtils::polylineArea(toPolyline(corners)));
+    confidence = 1;
+    locked = true;
 }
 
-ofPoint PaperDetector::unwarpPoint(const ofPoint &point, int outWidth, int outHeight) {
-    vector<Point2f> warpPoints;
-    copy(paper.begin(), paper.end(), back_inserter(warpPoints));
-    ShapeUtils::orderQuadForTransform(warpPoints);
+bool PaperDetector::track(const Mat &img) {
+    const int radius = searchRadius + patchRadius;
+    const cv::Size patchSize(2 * patchRadius + 1, 2 * patchRadius + 1);
+
+    vector<Point2f> quad(corners);
+    bool good[4];
+    int nGood = 0;
+    float score = 0;
+
+    Mat current, match;
+    for (int i = 0; i < 4; i++) {
+        Corner &c = tracked[i];
+        good[i] = false;
+
+        // Follow the corner from the last frame, within the same window
+        toGray(img(c.window), current);
+        flowIn[0] = corners[i] - Point2f(c.window.x, c.window.y);
+        cv::calcOpticalFlowPyrLK(c.previous, current, flowIn, flowOut, flowStatus, flowError,
+                cv::Size(15, 15), 1);
+
+        Point2f p = flowOut[0] + Point2f(c.window.x, c.window.y);
+        bool moved = flowStatus[0] && fabs(p.x - corners[i].x) <= searchRadius && fabs(p.y - corners[i].y) <= searchRadius;
+        if (moved) {
+            quad[i] = p;
+        }
+
+        c.window = cornerWindow(quad[i], radius, img.size());
+        toGray(img(c.window), c.previous);
+        if (!moved) {
+            continue;
+        }
+
+        // A hand over the corner won't look like the reference patch
+        cv::Rect patch(cv::Point(cvRound(p.x) - patchRadius, cvRound(p.y) - patchRadius) - c.window.tl(), patchSize);
+        if ((patch & cv::Rect(0, 0, c.window.width, c.window.height)) != patch) {
+            continue;
+        }
+        cv::matchTemplate(c.previous(patch), c.reference, match, CV_TM_CCOEFF_NORMED);
+        float s = match.at<float>(0, 0);
+        if (s > minCornerScore) {
+            good[i] = true;
+            nGood++;
+            score += s;
+        }
+    }
+
+    confidence = score / 4;
+    if (nGood < 3) {
+        return false;
+    }
+
+    if (nGood == 3) {
+        // Place the hidden corner where the other three say it should be
+        Point2f from[3], to[3];
+        int hidden = 0;
+        for (int i = 0, j = 0; i < 4; i++) {
+            if (good[i]) {
+                from[j] = tracked[i].locked;
+                to[j] = quad[i];
+                j++;
+            } else {
+                hidden = i;
+            }
+        }
+        Mat affine = cv::getAffineTransform(from, to);
+        const Point2f &l = tracked[hidden].locked;
+        quad[hidden] = Point2f(
+                affine.at<double>(0, 0) * l.x + affine.at<double>(0, 1) * l.y + affine.at<double>(0, 2),
+                affine.at<double>(1, 0) * l.x + affine.at<double>(1, 1) * l.y + affine.at<double>(1, 2));
+
+        Corner &c = tracked[hidden];
+        c.window = cornerWindow(quad[hidden], radius, img.size());
+        toGray(img(c.window), c.previous);
+    }
+
+    ofPolyline poly = toPolyline(quad);
+    float area = fabs(ShapeUtils::polylineArea(poly));
+    if (!ShapeUtils::isRectangle(poly) || fabs(area - lockedArea) > maxAreaChange * lockedArea) {
+        return false;
+    }
 
-    vector<Point2f> dstPoints(4);
-    dstPoints[0] = Point2f(0, 0);
-    dstPoints[1] = Point2f(outWidth, 0);
-    dstPoints[2] = Point2f(outWidth, outHeight);
-    dstPoints[3] = Point2f(0, outHeight);
+    setPaper(quad);
+    return true;
+}
+
+const Homography& PaperDetector::getHomography(int outWidth, int outHeight) {
+    cv::Size size(outWidth, outHeight);
+    int slot = 0;
+    while (slot < homographySlots && toPaperSize[slot] != size) {
+        slot++;
+    }
+    if (slot == homographySlots) {
+        slot = nextSlot;
+        nextSlot = (nextSlot + 1) % homographySlots;
+        toPaperSize[slot] = size;
+        toPaper[slot].setIdentity();
+    }
 
-    Mat transform = cv::getPerspectiveTransform(&warpPoints[0], &dstPoints[0]);
-    float pv[2] = {point.x, point.y};
-    Mat srcPoint = Mat(1, 1, CV_32FC2, pv);
-    Mat dstPoint;
-    cv::perspectiveTransform(srcPoint, dstPoint, transform);
+    if (corners.size() == 4) {
+        Point2f warpPoints[4];
+        std::copy(corners.begin(), corners.end(), warpPoints);
+        ShapeUtils::orderQuadForTransform(warpPoints);
+        toPaper[slot].set(warpPoints, outWidth, outHeight);
+    }
+    return toPaper[slot];
+}
 
-    dstPoint = dstPoint.reshape(1);
-    return ofPoint(dstPoint.at<float>(0), dstPoint.at<float>(1));
+ofPoint PaperDetector::unwarpPoint(const ofPoint &point, int outWidth, int outHeight) {
+    return getHomography(outWidth, outHeight).map(point);
 }
 
 ofPolyline PaperDetector::getPaper() {
     return ofxCv::toOf(paper);
 }
+
+const vector<cv::Point>& PaperDetector::getQuad() {
+    return paper;
+}
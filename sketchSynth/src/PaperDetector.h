@@ -3,25 +3,63 @@
 #include "ofMain.h"
 #include "ofxCv.h"
 
+#include "Homography.h"
 #include "ShapeUtils.h"
 
+/*
+ * Finds the largest rectangle in the frame. With tracking on, once the paper
+ * has been found its corners are followed in small windows from frame to
+ * frame, and the full search only runs again when tracking is lost.
+ *
+ * For several sheets, use one detector per sheet: each follow()s its own,
+ * and the ones that lost it claim() one of the rectangles a single search
+ * with findCandidates() turned up.
+ */
 class PaperDetector {
 public:
+    PaperDetector();
+
     void setup();
+    void reset();
     void draw();
+    static void draw(const vector<cv::Point> &quad);
     
     template <class T>
     bool detect(T &img) {
         return detect(ofxCv::toCv(img));
     }
     bool detect(cv::Mat img);
+
+    // Follows the paper's corners into img, if tracking has locked on.
+    // False if it hasn't, or if the paper was lost.
+    bool follow(cv::Mat img);
+
+    // Every rectangle in img, the largest first
+    void findCandidates(cv::Mat img, vector< vector<cv::Point> > &quads);
+
+    // Takes the candidate the paper was last seen in, or if it's never been
+    // found, the first one, and removes it from the list
+    bool claim(cv::Mat img, vector< vector<cv::Point> > &candidates);
+    // Takes the given candidate, whatever it is
+    void take(cv::Mat img, vector< vector<cv::Point> > &candidates, size_t pick);
+
+    // Where the paper was last found, if it ever was
+    bool hasPaper();
+    cv::Point2f getCenter();
+    // Half the longer side of where the paper was last found
+    float getReach();
+    // Unlocks and forgets where the paper was, so claim() takes any sheet
+    void forget();
+
+    void setTracking(bool track);
+    bool isTracking();
+    float getConfidence();
     
     template <class S, class D>
     void unwarp(S &src, D &dst) {
-        vector<cv::Point2f> warpPoints;
-        copy(paper.begin(), paper.end(), back_inserter(warpPoints));
-        ShapeUtils::orderQuadForTransform(warpPoints);
-        ofxCv::unwarpPerspective(src, dst, warpPoints);
+        cv::Mat srcMat = ofxCv::toCv(src), dstMat = ofxCv::toCv(dst);
+        const Homography &h = getHomography(dstMat.cols, dstMat.rows);
+        cv::warpPerspective(srcMat, dstMat, h.getMatrix(), dstMat.size(), cv::INTER_LINEAR);
     }
 
     template <class D>
@@ -29,15 +67,56 @@ public:
         unwarp(paperImage, dst);
     }
 
-    cv::Mat getTransformation(int outWidth, int outHeight);
+    // Maps camera coordinates onto the paper, unwarped to the given size.
+    // One is kept for each of the last few sizes asked for, so unwarping
+    // and mapping touches at different sizes don't undo each other's cache.
+    const Homography& getHomography(int outWidth, int outHeight);
 
     ofPoint unwarpPoint(const ofPoint &point, int outWidth, int outHeight);
 
     ofPolyline getPaper();
+    const vector<cv::Point>& getQuad();
 
 private:
+    bool findPaper(cv::Mat img);
+    void setPaper(const vector<cv::Point2f> &quad);
+
+    void lock(const cv::Mat &img);
+    bool track(const cv::Mat &img);
+    cv::Rect cornerWindow(const cv::Point2f &corner, int radius, const cv::Size &size);
+
     ofxCv::ContourFinder finder;
 
     cv::Mat paperImage;
     vector<cv::Point> paper;
+    vector<cv::Point2f> corners;
+
+    // Tracking state for each corner
+    struct Corner {
+        cv::Point2f locked;
+        cv::Mat reference;
+        cv::Mat previous;
+        cv::Rect window;
+    };
+    Corner tracked[4];
+
+    static const int homographySlots = 2;
+    Homography toPaper[homographySlots];
+    cv::Size toPaperSize[homographySlots];
+    int nextSlot;
+
+    bool tracking;
+    bool locked;
+    float confidence;
+    float lockedArea;
+
+    vector<cv::Point2f> flowIn;
+    vector<cv::Point2f> flowOut;
+    vector<uchar> flowStatus;
+    vector<float> flowError;
+
+    vector< pair<float, size_t> > areas;
+
+    static const int searchRadius = 20;
+    static const int patchRadius = 7;
 };
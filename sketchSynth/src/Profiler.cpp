@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <fstream>
+
+#include "Profiler.h"
+
+namespace {
+    struct ProfileEvent {
+        unsigned long long start;
+        unsigned int duration;
+        unsigned char stage;
+        unsigned char thread;
+    };
+
+    bool compareStart(const ProfileEvent &a, const ProfileEvent &b) {
+        return a.start < b.start;
+    }
+
+    const size_t capacity = 16384;
+    ProfileEvent events[capacity];
+    volatile unsigned long nextEvent = 0;
+
+    float averages[PROFILE_NUM_STAGES];
+    float peaks[PROFILE_NUM_STAGES];
+    volatile int statsLocks[PROFILE_NUM_STAGES];
+
+    volatile int threadCount = 0;
+    __thread int threadId = -1;
+
+    const char *stageNames[PROFILE_NUM_STAGES] = {
+        "grab",
+        "paper detect",
+        "unwarp",
+        "texture upload",
+        "background",
+        "morphology",
+        "contours",
+        "fingertips",
+        "control detect",
+        "interaction",
+        "osc send"
+    };
+
+    // Copy out whatever is in the ring, oldest first
+    vector<ProfileEvent> snapshot() {
+        unsigned long end = nextEvent;
+        unsigned long begin = end > capacity ? end - capacity : 0;
+
+        vector<ProfileEvent> out;
+        out.reserve(end - begin);
+        for (unsigned long i = begin; i < end; i++) {
+            out.push_back(events[i % capacity]);
+        }
+        std::sort(out.begin(), out.end(), compareStart);
+        return out;
+    }
+}
+
+volatile bool Profiler::enabled = false;
+
+//---------------------------------------------------------
+void Profiler::setEnabled(bool enable) {
+    if (enable && !enabled) {
+        nextEvent = 0;
+        for (int i = 0; i < PROFILE_NUM_STAGES; i++) {
+            averages[i] = 0;
+            peaks[i] = 0;
+        }
+    }
+    enabled = enable;
+}
+
+//---------------------------------------------------------
+void Profiler::record(ProfileStage stage, unsigned long long start) {
+    unsigned long long end = now();
+    unsigned int duration = end - start;
+
+    if (threadId < 0) {
+        threadId = __sync_fetch_and_add(&threadCount, 1);
+    }
+
+    ProfileEvent &e = events[__sync_fetch_and_add(&nextEvent, 1) % capacity];
+    e.start = start;
+    e.duration = duration;
+    e.stage = stage;
+    e.thread = threadId;
+
+    // Most stages are timed from one thread, but OSC send runs on every
+    // sheet's sender, so each stage's stats take a spinlock. It's only
+    // ever held for these two lines.
+    while (__sync_lock_test_and_set(&statsLocks[stage], 1)) {}
+    averages[stage] = 0.95 * averages[stage] + 0.05 * duration;
+    peaks[stage] = max((float) duration, 0.99f * peaks[stage]);
+    __sync_lock_release(&statsLocks[stage]);
+}
+
+//---------------------------------------------------------
+const char* Profiler::getStageName(ProfileStage stage) {
+    return stageNames[stage];
+}
+
+//---------------------------------------------------------
+float Profiler::getAverage(ProfileStage stage) {
+    return averages[stage];
+}
+
+//---------------------------------------------------------
+float Profiler::getPeak(ProfileStage stage) {
+    return peaks[stage];
+}
+
+//---------------------------------------------------------
+void Profiler::draw(float x, float y) {
+    const float lineHeight = 14;
+    const float barScale = 10;  // pixels per millisecond
+
+    ofSetColor(255);
+    ofDrawBitmapString("Stage            avg ms  peak ms", x, y);
+    y += lineHeight;
+
+    for (int i = 0; i < PROFILE_NUM_STAGES; i++) {
+        float avg = averages[i] / 1000;
+        float peak = peaks[i] / 1000;
+
+        ofFill();
+        ofSetColor(60);
+        ofRect(x + 260, y - 9, min(peak * barScale, 60.0f), 10);
+        ofSetColor(34, 183, 220);
+        ofRect(x + 260, y - 9, min(avg * barScale, 60.0f), 10);
+
+        ofSetColor(255);
+        ofDrawBitmapString(ofToString(stageNames[i]), x, y);
+        ofDrawBitmapString(ofToString(avg, 2), x + 136, y);
+        ofDrawBitmapString(ofToString(peak, 2), x + 200, y);
+        y += lineHeight;
+    }
+}
+
+//---------------------------------------------------------
+bool Profiler::saveTrace(const string &path) {
+    std::ofstream out(path.c_str());
+    if (!out) {
+        return false;
+    }
+
+    // Chrome's about:tracing format, with one complete event per stage run
+    vector<ProfileEvent> trace = snapshot();
+    out << "{\"traceEvents\":[\n";
+    for (size_t i = 0; i < trace.size(); i++) {
+        const ProfileEvent &e = trace[i];
+        out << "{\"name\":\"" << stageNames[e.stage] << "\",\"ph\":\"X\""
+            << ",\"ts\":" << e.start << ",\"dur\":" << e.duration
+            << ",\"pid\":1,\"tid\":" << (int) e.thread << "}"
+            << (i + 1 < trace.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    return out.good();
+}
+
+//---------------------------------------------------------
+bool Profiler::saveCsv(const string &path) {
+    std::ofstream out(path.c_str());
+    if (!out) {
+        return false;
+    }
+
+    vector<ProfileEvent> trace = snapshot();
+    out << "stage,thread,start_us,duration_us\n";
+    for (size_t i = 0; i < trace.size(); i++) {
+        const ProfileEvent &e = trace[i];
+        out << stageNames[e.stage] << "," << (int) e.thread << ","
+            << e.start << "," << e.duration << "\n";
+    }
+    return out.good();
+}
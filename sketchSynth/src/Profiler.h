@@ -0,0 +1,82 @@
+#pragma once
+
+#include "ofMain.h"
+
+enum ProfileStage {
+    PROFILE_GRAB,
+    PROFILE_PAPER_DETECT,
+    PROFILE_UNWARP,
+    PROFILE_TEXTURE_UPLOAD,
+    PROFILE_BACKGROUND,
+    PROFILE_MORPHOLOGY,
+    PROFILE_CONTOURS,
+    PROFILE_FINGERTIPS,
+    PROFILE_CONTROL_DETECT,
+    PROFILE_INTERACTION,
+    PROFILE_OSC_SEND,
+    PROFILE_NUM_STAGES
+};
+
+/*
+ * Records how long each stage of the pipeline takes into a fixed-size ring
+ * buffer, from any thread. When disabled, a timed scope costs one branch.
+ */
+namespace Profiler {
+    extern volatile bool enabled;
+
+    void setEnabled(bool enable);
+    inline bool isEnabled() {
+        return enabled;
+    }
+
+    inline unsigned long long now() {
+        return ofGetElapsedTimeMicros();
+    }
+    void record(ProfileStage stage, unsigned long long start);
+
+    const char* getStageName(ProfileStage stage);
+
+    // Rolling statistics, in microseconds
+    float getAverage(ProfileStage stage);
+    float getPeak(ProfileStage stage);
+
+    void draw(float x, float y);
+
+    bool saveTrace(const string &path);
+    bool saveCsv(const string &path);
+}
+
+class ScopedTimer {
+public:
+    ScopedTimer(ProfileStage stage)
+        : stage(stage)
+        , active(Profiler::enabled)
+        , start(active ? Profiler::now() : 0)
+    {}
+
+    ~ScopedTimer() {
+        if (active) {
+            Profiler::record(stage, start);
+        }
+    }
+
+private:
+    ProfileStage stage;
+    bool active;
+    unsigned long long start;
+};
+
+// For spans that don't fit a scope: PROFILE_START(name) notes the time in
+// a local, and PROFILE_END(stage, name) records from it if profiling was on
+// at the start
+#ifdef SKETCHSYNTH_NO_PROFILING
+#define PROFILE_SCOPE(stage)
+#define PROFILE_START(name)
+#define PROFILE_END(stage, name)
+#else
+#define PROFILE_START(name) unsigned long long name = Profiler::isEnabled() ? Profiler::now() : 0
+#define PROFILE_END(stage, name) do { if (name != 0) Profiler::record(stage, name); } while (0)
+#define PROFILE_SCOPE_NAME(line) profileTimer##line
+#define PROFILE_SCOPE_LINE(stage, line) ScopedTimer PROFILE_SCOPE_NAME(line)(stage)
+#define PROFILE_SCOPE(stage) PROFILE_SCOPE_LINE(stage, __LINE__)
+#endif
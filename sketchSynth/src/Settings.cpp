@@ -0,0 +1,62 @@
+#include "ofxXmlSettings.h"
+
+#include "Settings.h"
+
+//---------------------------------------------------------
+Settings::Settings()
+    : handMargin(80)
+    , touchPrediction(true)
+    , cameraLatency(0)
+    , oscBundle(true)
+    , oscDelay(-1)
+    , oscEpsilon(0.002)
+    , paperWidth(279.4)
+    , paperHeight(215.9)
+    , sheets(1)
+    , unwarpWidth(518)
+    , unwarpScale(1)
+    , pyramidDetection(true)
+    , redetectInterval(0)
+    , monitorRate(10)
+    , sideSurface(400)
+    , sideBand(6)
+    , sideLeft(0)
+    , sideRight(640)
+    , sideTolerance(24)
+    , sideSkew(50)
+    , sideDebounce(2)
+{
+}
+
+//---------------------------------------------------------
+bool Settings::load(const string &path) {
+    ofxXmlSettings xml;
+    if (!xml.loadFile(path)) {
+        return false;
+    }
+
+    xml.pushTag("settings");
+    handMargin = xml.getValue("hand:margin", handMargin);
+    touchPrediction = xml.getValue("touch:prediction", (int) touchPrediction) != 0;
+    cameraLatency = xml.getValue("touch:cameraLatency", cameraLatency);
+    oscBundle = xml.getValue("osc:bundle", (int) oscBundle) != 0;
+    oscDelay = xml.getValue("osc:delay", oscDelay);
+    oscEpsilon = xml.getValue("osc:epsilon", oscEpsilon);
+    paperWidth = xml.getValue("paper:width", paperWidth);
+    paperHeight = xml.getValue("paper:height", paperHeight);
+    sheets = xml.getValue("paper:sheets", sheets);
+    unwarpWidth = xml.getValue("unwarp:width", unwarpWidth);
+    unwarpScale = xml.getValue("unwarp:scale", unwarpScale);
+    pyramidDetection = xml.getValue("controls:pyramid", (int) pyramidDetection) != 0;
+    redetectInterval = xml.getValue("controls:redetect", redetectInterval);
+    monitorRate = xml.getValue("monitor:rate", monitorRate);
+    sideSurface = xml.getValue("side:surface", sideSurface);
+    sideBand = xml.getValue("side:band", sideBand);
+    sideLeft = xml.getValue("side:left", sideLeft);
+    sideRight = xml.getValue("side:right", sideRight);
+    sideTolerance = xml.getValue("side:tolerance", sideTolerance);
+    sideSkew = xml.getValue("side:skew", sideSkew);
+    sideDebounce = xml.getValue("side:debounce", sideDebounce);
+    xml.popTag();
+    return true;
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "ofMain.h"
+
+/*
+ * Tuning values, read from settings.xml in the data folder. Anything the
+ * file leaves out keeps its default.
+ */
+struct Settings {
+    Settings();
+
+    bool load(const string &path);
+
+    // Pixels around the paper that hand detection looks at, so a hand is
+    // seen as it comes in and not just once it's on the paper
+    int handMargin;
+
+    // Move touches ahead to where the fingers should be by the time the
+    // controls hear about them, making up for the time spent on vision
+    bool touchPrediction;
+
+    // Milliseconds between the camera seeing something and the frame
+    // arriving, which can't be measured, added to the prediction
+    int cameraLatency;
+
+    // Send everything from one frame as a single OSC bundle, leaving out
+    // slider values that moved less than oscEpsilon. Bundles are timetagged
+    // immediately unless oscDelay is 0 or more, which schedules them that
+    // many milliseconds ahead on this machine's clock. Only worth it with a
+    // receiver on the same machine or a synced clock, and it adds latency.
+    bool oscBundle;
+    int oscDelay;
+    float oscEpsilon;
+
+    // The paper's size, in any unit. Only its proportions matter.
+    float paperWidth;
+    float paperHeight;
+
+    // Sheets of that size looked for under the camera, up to 8. With more
+    // than one, each sends to /paper/<n>/* instead of /paper/*.
+    int sheets;
+
+    // Pixels across the unwarped image controls are detected on, or 0 to
+    // match how much of the camera image the paper covers, times
+    // unwarpScale. Controls are always placed in the same coordinates,
+    // 518 across, whatever the resolution.
+    int unwarpWidth;
+    float unwarpScale;
+
+    // Look for controls on a smaller copy of big unwarped images, and only
+    // use full resolution to outline the ones found
+    bool pyramidDetection;
+
+    // Milliseconds without a hand in view before looking for added or
+    // erased controls during play, which blanks the projection for a
+    // moment each time. 0, the default, turns it off.
+    int redetectInterval;
+
+    // Times a second the laptop screen's views of the camera and detectors
+    // are refreshed during play. 0 starts with them off, until 'm' turns
+    // them on at once a second. The projector is unaffected.
+    int monitorRate;
+
+    // With a side camera (--side-device or --side-replay), the row of its
+    // image the paper's surface is at, and how many rows above that a
+    // finger has to reach to be touching
+    int sideSurface;
+    int sideBand;
+
+    // The side image columns the left and right edges of the top camera's
+    // view fall on, how far off in columns a contact can be and still
+    // count, and how many milliseconds apart the two cameras' frames can be
+    float sideLeft;
+    float sideRight;
+    float sideTolerance;
+    int sideSkew;
+
+    // Side frames in a row it takes for a touch to go from touching to
+    // hovering or back
+    int sideDebounce;
+};
@@ -112,34 +112,10 @@ ofPolyline ShapeUtils::filterPolyline(const ofPolyline &poly, const int k) {
     return filtered;
 }
 
-void ShapeUtils::applyTransform(const cv::Mat &mtx) {
-    // Convert incoming matrix to float for OpenGL
-    cv::Mat mtxf;
-    if (mtx.depth() != CV_32F) {
-        mtx.convertTo(mtxf, CV_32F);
-    } else {
-        mtxf = mtx;
-    }
-
-    cv::Mat mtx3D = cv::Mat::eye(4, 4, CV_32FC1);
-    mtx3D.at<float>(0, 0) = mtxf.at<float>(0, 0);
-    mtx3D.at<float>(0, 1) = mtxf.at<float>(0, 1);
-    mtx3D.at<float>(0, 3) = mtxf.at<float>(0, 2);
-    mtx3D.at<float>(1, 0) = mtxf.at<float>(1, 0);
-    mtx3D.at<float>(1, 1) = mtxf.at<float>(1, 1);
-    mtx3D.at<float>(1, 3) = mtxf.at<float>(1, 2);
-    mtx3D.at<float>(3, 0) = mtxf.at<float>(2, 0);
-    mtx3D.at<float>(3, 1) = mtxf.at<float>(2, 1);
-
-    glMultTransposeMatrixf(mtx3D.ptr<float>(0));
+void ShapeUtils::applyTransform(const Homography &h) {
+    glMultMatrixf(h.getGLMatrix());
 }
 
-ofPoint ShapeUtils::warpPoint(const ofPoint &point, cv::Mat &mtx) {
-    float pv[2] = {point.x, point.y};
-    cv::Mat srcPoint = cv::Mat(1, 1, CV_32FC2, pv);
-    cv::Mat dstPoint;
-    cv::perspectiveTransform(srcPoint, dstPoint, mtx);
-
-    dstPoint = dstPoint.reshape(1);
-    return ofPoint(dstPoint.at<float>(0), dstPoint.at<float>(1));
+ofPoint ShapeUtils::warpPoint(const ofPoint &point, const Homography &h) {
+    return h.map(point);
 }
@@ -5,6 +5,8 @@
 #include "ofMain.h"
 #include "ofxCv.h"
 
+#include "Homography.h"
+
 namespace ShapeUtils {
     static const float DEFAULT_ANGLE = 2.5;
 
@@ -23,7 +25,7 @@ namespace ShapeUtils {
     ofPolyline filterPolyline(const ofPolyline &poly, const int k);
 
     template <class T>
-    void orderQuadForTransform(vector<T> &pts) {
+    void orderQuadForTransform(T pts[4]) {
         ofVec2f s01 = ofVec2f(pts[1].x - pts[0].x, pts[1].y - pts[0].y);
         ofVec2f s12 = ofVec2f(pts[2].x - pts[1].x, pts[2].y - pts[1].y);
 
@@ -31,7 +33,7 @@ namespace ShapeUtils {
         // CCW winding has a negative cross product
         if (cross.z < 0) {
             // Transform to CW winding
-            std::reverse(pts.begin(), pts.end());
+            std::reverse(pts, pts + 4);
             // Recompute the side vectors if we change the winding
             s01 = ofVec2f(pts[1].x - pts[0].x, pts[1].y - pts[0].y);
             s12 = ofVec2f(pts[2].x - pts[1].x, pts[2].y - pts[1].y);
@@ -48,10 +50,15 @@ namespace ShapeUtils {
             rotate += 2;
         }
 
-        std::rotate(pts.begin(), pts.begin() + rotate, pts.end());
+        std::rotate(pts, pts + rotate, pts + 4);
+    }
+
+    template <class T>
+    void orderQuadForTransform(vector<T> &pts) {
+        orderQuadForTransform(&pts[0]);
     }
 
-    void applyTransform(const cv::Mat &mtx);
+    void applyTransform(const Homography &h);
 
-    ofPoint warpPoint(const ofPoint &point, cv::Mat &mtx);
+    ofPoint warpPoint(const ofPoint &point, const Homography &h);
 };
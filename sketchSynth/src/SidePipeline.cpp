@@ -0,0 +1,101 @@
+#include "SidePipeline.h"
+
+//---------------------------------------------------------
+SidePipeline::SidePipeline()
+    : source(NULL)
+    , results(64)
+    , resetRequested(0)
+    , lastFrameTime(0)
+    , frameRate(0)
+{
+}
+
+//---------------------------------------------------------
+SidePipeline::~SidePipeline() {
+    if (isThreadRunning()) {
+        stop();
+    }
+    if (source != NULL) {
+        source->close();
+        delete source;
+    }
+}
+
+//---------------------------------------------------------
+bool SidePipeline::setup(FrameSource *frameSource) {
+    source = frameSource;
+    return source != NULL && source->setup();
+}
+
+//---------------------------------------------------------
+void SidePipeline::start() {
+    startThread(true, false);
+}
+
+//---------------------------------------------------------
+void SidePipeline::stop() {
+    waitForThread(true);
+}
+
+//---------------------------------------------------------
+ContactDetector& SidePipeline::getDetector() {
+    return detector;
+}
+
+//---------------------------------------------------------
+void SidePipeline::reset() {
+    __sync_lock_test_and_set(&resetRequested, 1);
+}
+
+//---------------------------------------------------------
+bool SidePipeline::poll(SideContacts &contacts) {
+    if (!results.peek(contacts)) {
+        return false;
+    }
+    results.pop();
+    return true;
+}
+
+//---------------------------------------------------------
+float SidePipeline::getFrameRate() {
+    return frameRate;
+}
+
+//---------------------------------------------------------
+int SidePipeline::getWidth() {
+    return source != NULL ? source->getWidth() : 0;
+}
+
+//---------------------------------------------------------
+void SidePipeline::threadedFunction() {
+    while (isThreadRunning()) {
+        if (__sync_lock_test_and_set(&resetRequested, 0)) {
+            detector.reset();
+        }
+
+        if (!source->update()) {
+            ofSleepMillis(1);
+            continue;
+        }
+
+        unsigned long long now = ofGetElapsedTimeMillis();
+        if (lastFrameTime > 0 && now > lastFrameTime) {
+            frameRate = 0.9 * frameRate + 0.1 * (1000.0 / (now - lastFrameTime));
+        }
+        lastFrameTime = now;
+
+        detector.detect(source->getFrame());
+
+        SideContacts out;
+        out.time = source->getTimestamp();
+        const vector<float> &contacts = detector.getContacts();
+        out.count = min((int) contacts.size(), (int) SideContacts::maxContacts);
+        for (int i = 0; i < out.count; i++) {
+            out.columns[i] = contacts[i];
+        }
+
+        // The vision thread drains the queue every frame, so it only fills
+        // up if that stops, and then the newest contacts are the ones lost
+        results.push(out);
+    }
+}
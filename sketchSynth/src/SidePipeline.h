@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ofMain.h"
+
+#include "ContactDetector.h"
+#include "FrameSource.h"
+#include "SpscQueue.h"
+
+// Where a side camera frame saw something touching the paper. Fixed size,
+// so passing one between threads never allocates.
+struct SideContacts {
+    SideContacts() : time(0), count(0) {}
+
+    static const int maxContacts = 10;
+
+    // Capture time. main() only allows live cameras or recordings on both
+    // sides, so this is on the same clock as the top camera's.
+    unsigned long long time;
+    int count;
+    float columns[maxContacts];
+};
+
+/*
+ * Grabs frames from the side camera and looks for contacts on a thread of
+ * its own, so it runs alongside the top camera's pipeline instead of after
+ * it. Every frame's contacts are queued for the vision thread, which picks
+ * the one nearest in time to each top camera frame.
+ */
+class SidePipeline : public ofThread {
+public:
+    SidePipeline();
+    ~SidePipeline();
+
+    // Takes ownership of the source
+    bool setup(FrameSource *source);
+    void start();
+    void stop();
+
+    // Call before start()
+    ContactDetector& getDetector();
+
+    // Learn the background again, starting with the next frame. Safe to
+    // call from any thread.
+    void reset();
+
+    // Vision thread side: the oldest contacts not yet picked up
+    bool poll(SideContacts &contacts);
+
+    float getFrameRate();
+    int getWidth();
+
+protected:
+    void threadedFunction();
+
+private:
+    FrameSource *source;
+    ContactDetector detector;
+
+    SpscQueue<SideContacts> results;
+    volatile int resetRequested;
+
+    unsigned long long lastFrameTime;
+    float frameRate;
+};
@@ -1,53 +1,153 @@
+#include <signal.h>
+
 #include "ofxXmlSettings.h"
 
 #include "SketchSynth.h"
 
+#include "Profiler.h"
 #include "ShapeUtils.h"
 
 using namespace ofxCv;
 using namespace cv;
 
-//---------------------------------------------------------
-void SketchSynth::setup() {
-    ofEnableSmoothing();
-    ofBackground(0);
+namespace {
+    volatile sig_atomic_t stopSignal = 0;
 
-	paperCam.initGrabber(640, 480);
-    paperCam.listDevices();
+    void onStopSignal(int) {
+        stopSignal = 1;
+    }
+}
 
-    foundPaper = false;
-    paperDetector.setup();
-	unwarped.allocate(518, 400, OF_IMAGE_COLOR);
+//---------------------------------------------------------
+SketchSynth::SketchSynth(FrameSource *source, bool headless, FrameSource *side)
+    : frameSource(source)
+    , sideSource(side)
+    , headless(headless)
+    , quit(false)
+{
+}
 
-    controlManager.setup();
+//---------------------------------------------------------
+void SketchSynth::setup() {
+    if (!headless) {
+        ofEnableSmoothing();
+        ofBackground(0);
+    }
 
-    topBackground.setLearningTime(1800);
-    topBackground.setThresholdValue(40);
-    topBackground.setDifferenceMode(RunningBackground::ABSDIFF);
+    if (!settings.load("settings.xml")) {
+        ofLog(OF_LOG_NOTICE, "No settings.xml found, using the defaults.");
+    }
 
-    doControlDetection = 0;
+    // The paper's long side is always across
+    float paperLong = max(settings.paperWidth, settings.paperHeight);
+    float paperShort = min(settings.paperWidth, settings.paperHeight);
+    layoutHeight = cvRound(layoutWidth * paperShort / paperLong);
+    if (!vision.setup(frameSource, layoutWidth, layoutHeight)) {
+        ofLog(OF_LOG_ERROR, "Could not open the frame source, nothing will be detected.");
+    }
+    sheetCount = ofClamp(settings.sheets, 1, maxSheets);
+    vision.setSheets(sheetCount);
+    vision.setHandMargin(settings.handMargin);
+    vision.setUnwarpResolution(settings.unwarpWidth, settings.unwarpScale);
+    if (sideSource != NULL) {
+        vision.setSideSurface(settings.sideSurface, settings.sideBand);
+        vision.setSideMapping(settings.sideLeft, settings.sideRight, settings.sideTolerance, settings.sideSkew);
+        vision.setSideDebounce(settings.sideDebounce);
+        if (!vision.setSideSource(sideSource)) {
+            ofLog(OF_LOG_ERROR, "Could not open the side camera, touches won't be confirmed.");
+        }
+    }
+    if (!headless) {
+        cameraTexture.allocate(vision.getCameraWidth(), vision.getCameraHeight(), GL_RGB);
+    }
+    newResult = false;
+    visionEpoch = 0;
+
+    monitorEnabled = !headless && settings.monitorRate > 0;
+    lastMonitorTime = 0;
+    detectorInputChanged = false;
+    detectorInputSheet = 0;
+
+    // With one sheet everything stays under /paper, where it always was
+    for (int i = 0; i < sheetCount; i++) {
+        Sheet &sheet = sheets[i];
+        OscSender &sender = sheet.controls.getSender();
+        if (sheetCount > 1) {
+            sender.setNamespace("/paper/" + ofToString(i));
+        }
+        sender.setBundling(settings.oscBundle);
+        sender.setBundleDelay(settings.oscDelay);
+        sender.setEpsilon(settings.oscEpsilon);
+        sheet.controls.setup();
+
+        sheet.controls.getDetector().setLayoutWidth(layoutWidth);
+        sheet.controls.getDetector().setPyramid(settings.pyramidDetection);
+        sheet.redetection.getDetector().setLayoutWidth(layoutWidth);
+        sheet.redetection.getDetector().setPyramid(settings.pyramidDetection);
+
+        sheet.doControlDetection = false;
+        sheet.lastRedetectTime = 0;
+        sheet.blank = false;
+        sheet.blankSince = 0;
+    }
+    layouts.load("layouts.xml");
+    layoutsChanged = false;
 
     debugDraw = false;
 
-    // Start the app in setup mode
+    // Start the app in setup mode. Without a window there's no way to align
+    // the projector, so it has to have been done already.
     if (!loadProjectorAlignment()) {
-        ofLog(OF_LOG_NOTICE, "No saved alignment found, starting from scratch.");
+        if (headless) {
+            ofLog(OF_LOG_WARNING, "No saved alignment found, run with a window once to align the projector.");
+        } else {
+            ofLog(OF_LOG_NOTICE, "No saved alignment found, starting from scratch.");
+        }
         resetProjectorAlignment();
     }
     setupMode();
+
+    vision.start();
+    for (int i = 0; i < sheetCount; i++) {
+        sheets[i].redetection.start();
+    }
 }
 
 //---------------------------------------------------------
 void SketchSynth::exit() {
-    controlManager.getSender().sendStopAll();
+    vision.stop();
+    saveLayouts();
+    for (int i = 0; i < sheetCount; i++) {
+        OscSender &sender = sheets[i].controls.getSender();
+        sheets[i].redetection.stop();
+        sender.sendStopAll();
+        sender.stop();
+    }
 }
 
 //---------------------------------------------------------
 void SketchSynth::update() {
+    // Pick up the newest vision result, if the camera thread has one
+    newResult = vision.update();
+    if (newResult) {
+        VisionResult &result = vision.getResult();
+        if (state == SETUP && !headless) {
+            // Alignment is done by clicking on the camera image, so it has to
+            // keep up
+            PROFILE_SCOPE(PROFILE_TEXTURE_UPLOAD);
+            Mat &camera = result.camera;
+            cameraTexture.loadData(camera.ptr(), camera.cols, camera.rows, GL_RGB);
+        } else if (monitorEnabled) {
+            unsigned long long now = ofGetElapsedTimeMillis();
+            if (now - lastMonitorTime >= 1000 / max(settings.monitorRate, 1)) {
+                PROFILE_SCOPE(PROFILE_TEXTURE_UPLOAD);
+                updateMonitor(result);
+                lastMonitorTime = now;
+            }
+        }
+    }
+
     switch (state) {
-        case EDIT:
-            editUpdate();
-            break;
         case SETUP:
             setupUpdate();
             break;
@@ -62,12 +162,6 @@ void SketchSynth::update() {
 
 //---------------------------------------------------------
 void SketchSynth::setupUpdate() {
-    paperCam.update();
-
-    if (paperCam.isFrameNew()) {
-	    foundPaper = paperDetector.detect(paperCam);
-    }
-
     if (!alignmentComplete && projectorPoints.size() == 4) {
         computeProjectorAlignment();
         if (!saveProjectorAlignment()) {
@@ -77,65 +171,215 @@ void SketchSynth::setupUpdate() {
 }
 
 //---------------------------------------------------------
-void SketchSynth::editUpdate() {
-    paperCam.update();
+void SketchSynth::playUpdate() {
+    VisionResult &result = vision.getResult();
+
+    // Only act on new frames the camera thread processed in this play session
+    if (!newResult || !result.tracked || result.epoch != visionEpoch) {
+        return;
+    }
+
+    for (int i = 0; i < sheetCount; i++) {
+        Sheet &sheet = sheets[i];
+        const SheetResult &found = result.sheets[i];
+
+        // Everything the controls send for this frame goes out together
+        OscSender &sender = sheet.controls.getSender();
+        sender.beginBundle();
+
+        // Each sheet's controls are looked for as soon as it's found
+        if (sheet.doControlDetection) {
+            if (found.found) {
+                PROFILE_SCOPE(PROFILE_CONTROL_DETECT);
+                detectControls(sheet, found);
+                sheet.doControlDetection = false;
+                sheet.lastRedetectTime = ofGetElapsedTimeMillis();
+            }
+        } else if (settings.redetectInterval > 0) {
+            redetectControls(sheet, result, found);
+        }
+
+        {
+            PROFILE_SCOPE(PROFILE_INTERACTION);
+            sheet.controls.processTouches(predictTouches(sheet, result, found));
+        }
+
+        sender.endBundle();
+    }
+}
+
+//---------------------------------------------------------
+void SketchSynth::detectControls(Sheet &sheet, const SheetResult &found) {
+    // A sheet that's been seen before gets its controls back straight away.
+    // If it's the wrong layout after all, redetection will fix it up.
+    if (found.found) {
+        sheet.fingerprint.compute(found.unwarped);
+        sheet.fingerprinted = true;
+        if (layouts.find(sheet.fingerprint, sheet.cachedLayout)) {
+            sheet.controls.setLayout(sheet.cachedLayout);
+            return;
+        }
+    }
+
+    sheet.controls.detect(found.unwarped);
+    detectorInputChanged = true;
+    detectorInputSheet = &sheet - sheets;
+    rememberLayout(sheet);
+}
+
+//---------------------------------------------------------
+void SketchSynth::rememberLayout(Sheet &sheet) {
+    // Always under the fingerprint of the clean sheet play started with,
+    // which is what it'll look like the next time it's put down. Saving
+    // waits until play ends.
+    const vector<ControlShape> &layout = sheet.controls.getLayout();
+    if (!sheet.fingerprinted || layout.empty()) {
+        return;
+    }
+    layouts.store(sheet.fingerprint, layout);
+    layoutsChanged = true;
 }
 
+//---------------------------------------------------------
+void SketchSynth::saveLayouts() {
+    if (layoutsChanged && !layouts.save("layouts.xml")) {
+        ofLog(OF_LOG_WARNING, "Could not save layouts.xml, learned layouts will be lost on exit.");
+    }
+    layoutsChanged = false;
+}
 
 //---------------------------------------------------------
-void SketchSynth::playUpdate() {
-    // Update the paper monitoring camera
-    paperCam.update();
-
-    // If we have a new frame and enough time as passed
-    int time = ofGetElapsedTimeMillis();
-	if (paperCam.isFrameNew() && time - playStartTime > toPlayDelay) {
-        /*
-         * TODO When should we do this? We need unwarped images for accurate
-         * hand coordinates, but hands can distort the bounding rectangle. Can
-         * we assume that the paper doesn't move in play mode?
-         */
-        // Look for paper and if we have it, unwarp the image
-	    bool paper = paperDetector.detect(paperCam);
-        foundPaper = foundPaper || paper;
-        if (foundPaper) {
-            paperDetector.unwarp(unwarped);
-            unwarped.update();
+void SketchSynth::redetectControls(Sheet &sheet, const VisionResult &result, const SheetResult &found) {
+    // A layout only replaces the controls once it's been seen twice in a
+    // row, so a smudge or a shadow in one frame doesn't add anything
+    int tag;
+    if (sheet.redetection.poll(sheet.redetected, tag) && tag == visionEpoch) {
+        if (sheet.controls.sameLayout(sheet.redetected, sheet.lastRedetected)) {
+            PROFILE_SCOPE(PROFILE_CONTROL_DETECT);
+            if (sheet.controls.setLayout(sheet.redetected) && result.hands.empty()) {
+                rememberLayout(sheet);
+            }
         }
+        sheet.lastRedetected.swap(sheet.redetected);
+    }
+
+    // Hands would be found as controls, so only look at a clear sheet. The
+    // wait starts over whenever one is in view, so the projection only
+    // blinks once the sheet has been left alone, not between every touch.
+    unsigned long long now = ofGetElapsedTimeMillis();
+    if (!result.hands.empty()) {
+        sheet.lastRedetectTime = now;
+    }
+    if (!found.found || !result.hands.empty()
+            || now - sheet.lastRedetectTime <= (unsigned long long) settings.redetectInterval) {
+        sheet.blank = false;
+        sheet.blankSince = 0;
+        return;
+    }
 
-        if (doControlDetection) {
-            controlManager.detect(unwarped);
-            doControlDetection = false;
+    // Without a window nothing is projected, so any frame will do
+    if (!headless) {
+        sheet.blank = true;
+        unsigned long long delay = blankDelay + max(settings.cameraLatency, 0);
+        if (sheet.blankSince == 0 || result.received <= sheet.blankSince + delay) {
+            return;
         }
+    }
+    sheet.redetection.submit(found.unwarped, visionEpoch);
+    sheet.lastRedetectTime = now;
+    sheet.blank = false;
+    sheet.blankSince = 0;
+}
+
+//---------------------------------------------------------
+const vector<Touch>& SketchSynth::predictTouches(Sheet &sheet, const VisionResult &result, const SheetResult &found) {
+    if (!settings.touchPrediction) {
+        return found.touches;
+    }
 
-        Mat paperCamMat = toCv(paperCam);
-        Mat paperCamChan = Mat::zeros(paperCam.height, paperCam.width, CV_8UC3);
-        int fromTo[] = { 1,0 , 1,1 , 1,2 };
-        mixChannels(&paperCamMat, 1, &paperCamChan, 1, fromTo, 3);
+    // How long ago the frame came in, plus what the camera took before that.
+    // Guessing too far ahead overshoots whenever a finger stops.
+    unsigned long long now = ofGetElapsedTimeMillis();
+    int latency = settings.cameraLatency;
+    if (now > result.received) {
+        latency += now - result.received;
+    }
+    if (latency > maxPrediction) {
+        latency = maxPrediction;
+    }
+
+    vector<Touch> &predicted = sheet.predictedTouches;
+    predicted = found.touches;
+    for (size_t i = 0; i < predicted.size(); i++) {
+        Touch &touch = predicted[i];
+        touch.point = touch.predict(latency);
+    }
+    return predicted;
+}
 
-        topBackground.update(paperCamChan, foreground);
-        if (handDetector.detect(foreground, paperDetector.getPaper())) {
-            ofPoint rawPoint = handDetector.getFingerPoint();
-            controlManager.processInteraction(paperDetector.unwarpPoint(rawPoint, unwarped.width, unwarped.height));
+
+//---------------------------------------------------------
+int SketchSynth::runHeadless(int controlPort) {
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+
+    setup();
+    control.setup(controlPort);
+    ofLog(OF_LOG_NOTICE, "Running headless, control messages on port " + ofToString(controlPort));
+    playMode();
+
+    while (!quit && !stopSignal) {
+        handleControlMessages();
+        update();
+
+        // Everything happens on the vision thread's schedule, so only wake
+        // up about as often as it can have something new
+        if (!newResult) {
+            ofSleepMillis(2);
         }
     }
+
+    exit();
+    return 0;
 }
 
+//---------------------------------------------------------
+void SketchSynth::handleControlMessages() {
+    ofxOscMessage m;
+    while (control.hasWaitingMessages()) {
+        control.getNextMessage(&m);
+        const string &address = m.getAddress();
+        if (address == "/sketchsynth/play") {
+            if (state == PLAY) {
+                editMode();
+            }
+            playMode();
+        } else if (address == "/sketchsynth/edit") {
+            editMode();
+        } else if (address == "/sketchsynth/quit") {
+            quit = true;
+        } else {
+            ofLog(OF_LOG_WARNING, "Ignoring unknown control message " + address);
+        }
+    }
+}
 
 //---------------------------------------------------------
 void SketchSynth::playMode() {
     if (state == EDIT || state == SETUP) {
         // Reset and redetect controls
-        controlManager.reset();
-        doControlDetection = true;
-
-        // Reset the background to the current image
-        topBackground.reset();
-
-        // Look for new paper, or paper in a new position
-        foundPaper = false;
+        for (int i = 0; i < sheetCount; i++) {
+            Sheet &sheet = sheets[i];
+            sheet.controls.reset();
+            sheet.doControlDetection = true;
+            sheet.lastRedetected.clear();
+            sheet.fingerprinted = false;
+            sheet.blank = false;
+            sheet.blankSince = 0;
+        }
 
-        playStartTime = ofGetElapsedTimeMillis();
+        // Resets the background and looks for new paper
+        visionEpoch = vision.setMode(VISION_PLAY);
 
         // TODO Reset and restart audio
     }
@@ -146,8 +390,9 @@ void SketchSynth::playMode() {
 //---------------------------------------------------------
 void SketchSynth::editMode() {
     if (state == PLAY) {
-        controlManager.getSender().sendStopAll();
+        stopAll();
     }
+    visionEpoch = vision.setMode(VISION_CAPTURE);
     state = EDIT;
 }
 
@@ -155,13 +400,22 @@ void SketchSynth::editMode() {
 //---------------------------------------------------------
 void SketchSynth::setupMode() {
     if (state == PLAY) {
-        controlManager.getSender().sendStopAll();
+        stopAll();
     }
+    visionEpoch = vision.setMode(VISION_PAPER);
 
     state = SETUP;
 }
 
 
+//---------------------------------------------------------
+void SketchSynth::stopAll() {
+    for (int i = 0; i < sheetCount; i++) {
+        sheets[i].controls.getSender().sendStopAll();
+    }
+    saveLayouts();
+}
+
 //---------------------------------------------------------
 void SketchSynth::draw() {
     switch (state) {
@@ -181,6 +435,8 @@ void SketchSynth::draw() {
 
 //---------------------------------------------------------
 void SketchSynth::infoDraw() {
+    VisionResult &result = vision.getResult();
+
     int xp = padding / 2;
     int yp = padding;
 
@@ -188,27 +444,28 @@ void SketchSynth::infoDraw() {
     ofFill();
     ofRect(0, 0, screenSeparation, ofGetHeight());
 
-    // Draw the live camera feed
     ofSetLineWidth(1);
     ofSetColor(255);
-    ofDrawBitmapString("Camera", xp, yp - 5);
-    if (!debugDraw) {
-        paperCam.draw(xp, yp, 320, 240);
-    } else {
-        Mat paperCamMat = toCv(paperCam);
-        Mat paperCamChannel = Mat::zeros(paperCam.height, paperCam.width, CV_8UC3);
-        int fromTo[] = { 1,0 , 1,1 , 1,2 };
-        mixChannels(&paperCamMat, 1, &paperCamChannel, 1, fromTo, 3);
-        drawMat(paperCamChannel, xp, yp, 320, 240);
+    if (!monitorEnabled) {
+        ofDrawBitmapString("Monitor off, press 'm' to turn it on", xp, yp - 5);
+        return;
     }
 
+    // Draw the live camera feed
+    ofDrawBitmapString("Camera", xp, yp - 5);
+    cameraTexture.draw(xp, yp, 320, 240);
+
     // Draw paper and hand overlays on camera
     ofPushMatrix();
     ofTranslate(xp, yp);
     ofScale(0.5, 0.5);
-    paperDetector.draw();
+    for (size_t i = 0; i < monitorPapers.size(); i++) {
+        PaperDetector::draw(monitorPapers[i]);
+    }
     ofSetColor(0, 255, 0);
-    handDetector.draw();
+    for (size_t i = 0; i < monitorHands.size(); i++) {
+        monitorHands[i].draw();
+    }
     ofPopMatrix();
 
     yp += (240 + padding);
@@ -216,40 +473,118 @@ void SketchSynth::infoDraw() {
     // Draw control detector input
     ofSetColor(255);
     ofDrawBitmapString("Control Detector", xp, yp - 5);
-    controlManager.drawDetectorInput(xp, yp, 320, 240);
+    if (detectorTexture.bAllocated()) {
+        detectorTexture.draw(xp, yp, 320, 240);
+    }
 
     yp += (240 + padding);
 
-    const vector< pair<string, size_t> > &controls = controlManager.listControls();
     stringstream controlStream;
-    for (size_t i = 0; i < controls.size(); i++) {
-        controlStream << controls[i].second << " " << controls[i].first << endl;
+    for (int s = 0; s < sheetCount; s++) {
+        const vector< pair<string, size_t> > &controls = sheets[s].controls.listControls();
+        if (sheetCount > 1) {
+            controlStream << "Sheet " << s << ": ";
+        }
+        for (size_t i = 0; i < controls.size(); i++) {
+            controlStream << controls[i].second << " " << controls[i].first << (sheetCount > 1 ? " " : "\n");
+        }
+        if (sheetCount > 1) {
+            controlStream << endl;
+        }
     }
     ofDrawBitmapString(controlStream.str(), xp, yp - 5);
 
     // Draw performance statistics
-    ofDrawBitmapString(ofToString((int) ofGetFrameRate()) + " fps", xp, ofGetHeight() - 10);
-    if (foundPaper) {
-        ofDrawBitmapString("Paper detected", xp, ofGetHeight() - padding - 10);
-    } else {
-        ofDrawBitmapString("No paper", xp, ofGetHeight() - padding - 10);
+    string side;
+    if (sideSource != NULL) {
+        side = ", side " + ofToString((int) vision.getSideFrameRate()) + " fps"
+            + (result.tracked && !result.sideMatched ? ", unmatched" : "");
+    }
+    ofDrawBitmapString(ofToString((int) ofGetFrameRate()) + " fps, vision "
+            + ofToString((int) vision.getFrameRate()) + " fps, "
+            + ofToString(vision.getSkippedFrames()) + " skipped, "
+            + ofToString(vision.getDroppedFrames()) + " dropped" + side, xp, ofGetHeight() - 10);
+    size_t queued = 0;
+    unsigned long overflowed = 0, coalesced = 0, deferred = 0;
+    for (int i = 0; i < sheetCount; i++) {
+        OscSender &sender = sheets[i].controls.getSender();
+        queued += sender.getQueueDepth();
+        overflowed += sender.getOverflowCount();
+        coalesced += sender.getCoalescedCount();
+        deferred += sender.getDeferredCount();
     }
+    ofDrawBitmapString("OSC queue " + ofToString(queued) + ", "
+            + ofToString(overflowed) + " overflowed, "
+            + ofToString(coalesced) + " merged, "
+            + ofToString(deferred) + " deferred", xp, ofGetHeight() - 2 * padding - 10);
+    ofDrawBitmapString(describePaper(result), xp, ofGetHeight() - padding - 10);
 
     yp = padding;
     xp += (320 + padding);
 
     // Draw processed background subtraction
     ofDrawBitmapString("BackSub Raw", xp, yp - 5);
-    drawMat(foreground, xp, yp, 320, 240);
+    drawRegion(foregroundTexture, monitorRegion, xp, yp, 320, 240);
     yp += (240 + padding);
 
     // Draw processed background subtraction
     ofDrawBitmapString("BackSub Processed", xp, yp - 5);
-    handDetector.drawDetectorInput(xp, yp, 320, 240);
+    drawRegion(handInputTexture, monitorRegion, xp, yp, 320, 240);
+    yp += (240 + padding);
+
+    // Draw rolling stage timings
+    if (Profiler::isEnabled()) {
+        Profiler::draw(xp, yp);
+    }
+}
+
+//---------------------------------------------------------
+void SketchSynth::updateMonitor(const VisionResult &result) {
+    // In debug mode the camera shows only the green channel, which is all
+    // hand detection sees
+    if (debugDraw) {
+        cameraGreen.create(result.camera.rows, result.camera.cols, CV_8UC1);
+        int fromTo[] = { 1,0 };
+        mixChannels(&result.camera, 1, &cameraGreen, 1, fromTo, 1);
+        upload(cameraTexture, cameraGreen);
+    } else {
+        upload(cameraTexture, result.camera);
+    }
+    monitorPapers.resize(result.sheets.size());
+    for (size_t i = 0; i < result.sheets.size(); i++) {
+        monitorPapers[i] = result.sheets[i].paper;
+    }
+    monitorHands = result.hands;
+
+    if (result.tracked) {
+        upload(foregroundTexture, result.foreground);
+        upload(handInputTexture, result.handInput);
+        monitorRegion = result.handRegion;
+    }
+
+    // Only changes when controls are detected
+    if (detectorInputChanged) {
+        upload(detectorTexture, sheets[detectorInputSheet].controls.getDetectorInput());
+        detectorInputChanged = false;
+    }
+}
+
+//---------------------------------------------------------
+void SketchSynth::upload(ofTexture &texture, const Mat &mat) {
+    if (mat.empty()) {
+        return;
+    }
+    int format = mat.channels() == 1 ? GL_LUMINANCE : GL_RGB;
+    if (!texture.bAllocated() || texture.getWidth() < mat.cols || texture.getHeight() < mat.rows) {
+        texture.allocate(mat.cols, mat.rows, format);
+    }
+    texture.loadData(mat.ptr(), mat.cols, mat.rows, format);
 }
 
 //---------------------------------------------------------
 void SketchSynth::playDraw() {
+    VisionResult &result = vision.getResult();
+
     infoDraw();
 
     //----------------------------//
@@ -257,25 +592,55 @@ void SketchSynth::playDraw() {
     //----------------------------//
 
     ofTranslate(screenSeparation, 0);
-    ShapeUtils::applyTransform(toProjectorMatrix);
-
-    // This push and pop is only needed because we're (possibly) drawing the paper outline
-    ofPushMatrix();
-    if (foundPaper) {
-        ShapeUtils::applyTransform(paperDetector.getTransformation(unwarped.width, unwarped.height));
+    for (size_t i = 0; i < result.sheets.size(); i++) {
+        const SheetResult &found = result.sheets[i];
+        Sheet &sheet = sheets[i];
+        if (sheet.blank) {
+            if (sheet.blankSince == 0) {
+                sheet.blankSince = ofGetElapsedTimeMillis();
+            }
+            continue;
+        }
+        sheet.controls.drawControls(toProjector, found.found ? &found.paperTransform : NULL);
     }
-    controlManager.drawControls();
-    ofPopMatrix();
 
     // Outline the paper for debugging
     if (debugDraw) {
+        ShapeUtils::applyTransform(toProjector);
         ofNoFill();
         ofSetColor(255, 0, 0);
         ofSetLineWidth(2);
-        paperDetector.getPaper().draw();
+        for (size_t i = 0; i < result.sheets.size(); i++) {
+            ofxCv::toOf(result.sheets[i].paper).draw();
+        }
     }
 }
 
+//---------------------------------------------------------
+string SketchSynth::describePaper(const VisionResult &result) {
+    if (result.sheets.empty()) {
+        return "No paper";
+    } else if (result.sheets.size() == 1) {
+        const SheetResult &found = result.sheets[0];
+        if (found.tracking) {
+            return "Paper tracked (" + ofToString(found.confidence, 2) + ")";
+        }
+        return found.found ? "Paper detected" : "No paper";
+    }
+
+    string s = "Sheets";
+    for (size_t i = 0; i < result.sheets.size(); i++) {
+        const SheetResult &found = result.sheets[i];
+        s += i == 0 ? ": " : ", ";
+        if (found.tracking) {
+            s += ofToString(found.confidence, 2);
+        } else {
+            s += found.found ? "found" : "none";
+        }
+    }
+    return s;
+}
+
 //---------------------------------------------------------
 void SketchSynth::editDraw() {
     infoDraw();
@@ -283,10 +648,14 @@ void SketchSynth::editDraw() {
 
 //---------------------------------------------------------
 void SketchSynth::setupDraw() {
+    VisionResult &result = vision.getResult();
+
     ofSetLineWidth(1);
     ofSetColor(255);
-    paperCam.draw(0, 0);
-    paperDetector.draw();
+    cameraTexture.draw(0, 0);
+    for (size_t i = 0; i < result.sheets.size(); i++) {
+        PaperDetector::draw(result.sheets[i].paper);
+    }
 
     ofSetColor(0, 255, 0);
     ofFill();
@@ -298,11 +667,7 @@ void SketchSynth::setupDraw() {
     // Draw performance statistics
     ofSetColor(255);
     ofDrawBitmapString(ofToString((int) ofGetFrameRate()) + " fps", 10, ofGetHeight() - 10);
-    if (foundPaper) {
-        ofDrawBitmapString("Paper detected", 10, ofGetHeight() - padding - 10);
-    } else {
-        ofDrawBitmapString("No paper", 10, ofGetHeight() - padding - 10);
-    }
+    ofDrawBitmapString(describePaper(result), 10, ofGetHeight() - padding - 10);
     ofDrawBitmapString("Press 'r' to reset alignment", 10, ofGetHeight() - 2 * padding - 10);
 
     // Draw the projection rectangle
@@ -313,7 +678,7 @@ void SketchSynth::setupDraw() {
 
     if (projectorPoints.size() == 4) {
         ofSetColor(34, 183, 220);
-        ShapeUtils::applyTransform(toProjectorMatrix);
+        ShapeUtils::applyTransform(toProjector);
         ofPolyline quad = ofxCv::toOf(projectorPoints);
         ofPoint c = ShapeUtils::getCentroid2D(quad);
         ofFill();
@@ -326,10 +691,25 @@ void SketchSynth::setupDraw() {
 }
 
 
+//---------------------------------------------------------
+void SketchSynth::drawRegion(ofTexture &texture, const cv::Rect &region, float x, float y, float w, float h) {
+    // Draws a crop of the camera frame where it sits in the whole frame
+    float sx = w / vision.getCameraWidth();
+    float sy = h / vision.getCameraHeight();
+
+    ofNoFill();
+    ofSetColor(60);
+    ofRect(x, y, w, h);
+    ofSetColor(255);
+    if (texture.bAllocated()) {
+        texture.draw(x + region.x * sx, y + region.y * sy, region.width * sx, region.height * sy);
+    }
+}
+
 //---------------------------------------------------------
 void SketchSynth::resetProjectorAlignment() {
     projectorPoints.clear();
-    toProjectorMatrix = Mat::eye(3, 3, CV_32F);
+    toProjector.setIdentity();
     alignmentComplete = false;
 }
 
@@ -387,20 +767,26 @@ bool SketchSynth::loadProjectorAlignment() {
 
 //---------------------------------------------------------
 void SketchSynth::computeProjectorAlignment() {
-    vector<Point2f> dstPoints(4);
-    dstPoints[0] = Point2f(0, 0);
-    dstPoints[1] = Point2f(projWidth, 0);
-    dstPoints[2] = Point2f(projWidth, projHeight);
-    dstPoints[3] = Point2f(0, projHeight);
-
     // This matrix transforms from point in camera space to points in
     // projector space, i.e. if point a is at (x, y) as seen by the camera,
     // transforming point b at (2x, 2y) will make it appear correct when
     // projected back into the scene.
-    toProjectorMatrix = getPerspectiveTransform(&projectorPoints[0], &dstPoints[0]);
+    toProjector.set(&projectorPoints[0], projWidth, projHeight);
     alignmentComplete = true;
 }
 
+//---------------------------------------------------------
+void SketchSynth::saveProfile() {
+    string name = "profile-" + ofGetTimestampString();
+    string trace = ofToDataPath(name + ".json");
+    string csv = ofToDataPath(name + ".csv");
+    if (Profiler::saveTrace(trace) && Profiler::saveCsv(csv)) {
+        ofLog(OF_LOG_NOTICE, "Saved profile to " + trace + " and " + csv);
+    } else {
+        ofLog(OF_LOG_WARNING, "Could not save profile " + name);
+    }
+}
+
 //---------------------------------------------------------
 void SketchSynth::keyPressed(int key) {
     switch (key) {
@@ -425,6 +811,15 @@ void SketchSynth::keyPressed(int key) {
         case 'd':
             debugDraw = !debugDraw;
             break;
+        case 'm':
+            monitorEnabled = !monitorEnabled;
+            break;
+        case 't':
+            Profiler::setEnabled(!Profiler::isEnabled());
+            break;
+        case 'T':
+            saveProfile();
+            break;
         default:
             break;
     }
@@ -2,15 +2,32 @@
 
 #include "ofMain.h"
 #include "ofxCv.h"
+#include "ofxOsc.h"
 
-#include "PaperDetector.h"
+#include "ControlDetectionJob.h"
 #include "ControlManager.h"
-#include "HandDetector.h"
+#include "LayoutCache.h"
+#include "Settings.h"
+#include "VisionPipeline.h"
 
 enum AppState { PLAY, EDIT, SETUP };
 
+#define DEFAULT_CONTROL_PORT 12346
+
 class SketchSynth : public ofBaseApp {
     public:
+        // Takes ownership of the source; the default camera is used without one.
+        // A headless app never touches GL, and is only run by runHeadless().
+        // With a side source, touches only count once that camera sees the
+        // finger on the paper.
+        SketchSynth(FrameSource *source = NULL, bool headless = false, FrameSource *sideSource = NULL);
+
+        // Plays without a window, until /sketchsynth/quit or a signal.
+        // Controlled by OSC on the port: /sketchsynth/play finds the paper
+        // and controls again, and /sketchsynth/edit stops everything until
+        // the next play.
+        int runHeadless(int controlPort = DEFAULT_CONTROL_PORT);
+
         void setup();
         void update();
         void draw();
@@ -23,45 +40,116 @@ class SketchSynth : public ofBaseApp {
         void setupDraw();
 
         void infoDraw();
+        string describePaper(const VisionResult &result);
+        void updateMonitor(const VisionResult &result);
+        void upload(ofTexture &texture, const cv::Mat &mat);
 
-        void editUpdate();
         void editDraw();
 
+        struct Sheet;
+
         void playUpdate();
+        void detectControls(Sheet &sheet, const SheetResult &found);
+        void redetectControls(Sheet &sheet, const VisionResult &result, const SheetResult &found);
+        void rememberLayout(Sheet &sheet);
+        void saveLayouts();
+        const vector<Touch>& predictTouches(Sheet &sheet, const VisionResult &result, const SheetResult &found);
         void playDraw();
 
         void playMode();
         void editMode();
         void setupMode();
+        void stopAll();
 
         void resetProjectorAlignment();
         bool saveProjectorAlignment();
         bool loadProjectorAlignment();
         void computeProjectorAlignment();
 
-        ofVideoGrabber paperCam;
+        void saveProfile();
 
-        PaperDetector paperDetector;
-        ofImage unwarped;
+        void handleControlMessages();
 
-        HandDetector handDetector;
+        void drawRegion(ofTexture &texture, const cv::Rect &region, float x, float y, float w, float h);
 
-        bool foundPaper;
-        AppState state;
+        Settings settings;
 
-        ofxCv::RunningBackground topBackground;
-        cv::Mat foreground;
+        FrameSource *frameSource;
+        FrameSource *sideSource;
+        bool headless;
+        ofxOscReceiver control;
+        bool quit;
+        VisionPipeline vision;
+        bool newResult;
+        int visionEpoch;
+
+        ofTexture cameraTexture;
+
+        // The laptop screen's views, only uploaded from a new vision result
+        // and at most settings.monitorRate times a second. The overlays are
+        // kept from the same result so they line up with the images.
+        bool monitorEnabled;
+        unsigned long long lastMonitorTime;
+        bool detectorInputChanged;
+        cv::Mat cameraGreen;
+        ofTexture foregroundTexture;
+        ofTexture handInputTexture;
+        ofTexture detectorTexture;
+        int detectorInputSheet;
+        cv::Rect monitorRegion;
+        vector< vector<cv::Point> > monitorPapers;
+        vector<Hand> monitorHands;
+
+        AppState state;
 
-        int playStartTime;
-        static const int toPlayDelay = 250;
+        // Controls and touches are placed on the paper in these coordinates,
+        // whatever size the unwarped image is. The height follows the paper.
+        static const int layoutWidth = 518;
+        int layoutHeight;
 
         //--- CONTROL VARIABLE ---//
-        ControlManager controlManager;
-        bool doControlDetection;
+        // Everything play keeps for one sheet of paper. Each has its own
+        // controls, sending to an OSC namespace of its own when there are
+        // several.
+        struct Sheet {
+            Sheet() : doControlDetection(false), lastRedetectTime(0), blank(false), blankSince(0), fingerprinted(false) {}
+
+            ControlManager controls;
+            bool doControlDetection;
+            vector<Touch> predictedTouches;
+
+            // Looks for added or erased controls during play
+            ControlDetectionJob redetection;
+            vector<ControlShape> redetected;
+            vector<ControlShape> lastRedetected;
+            unsigned long long lastRedetectTime;
+
+            // The projected controls would be found as sketches, so they're
+            // blanked until a frame taken after the projector went dark
+            // comes in, and that's the one redetection gets
+            bool blank;
+            unsigned long long blankSince;
+
+            // Taken from the clean sheet when play found it
+            SheetFingerprint fingerprint;
+            bool fingerprinted;
+            vector<ControlShape> cachedLayout;
+        };
+        static const int maxSheets = 8;
+        Sheet sheets[maxSheets];
+        int sheetCount;
+
+        // Layouts of sheets seen before, so they don't need detecting again
+        LayoutCache layouts;
+        bool layoutsChanged;
+        static const int maxPrediction = 100;
+        // Milliseconds from the projector going dark to a camera frame
+        // that's sure not to show the controls, on top of cameraLatency
+        static const int blankDelay = 100;
 
         //--- SETUP VARIABLES ---//
         vector<cv::Point2f> projectorPoints;
-        cv::Mat toProjectorMatrix;
+        Homography toProjector;
         bool alignmentComplete;
 
         static const int projWidth = 848;
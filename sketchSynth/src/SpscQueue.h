@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+
+#include <vector>
+
+/*
+ * Lock-free, fixed-size FIFO between one producer and one consumer thread.
+ *
+ * Each side only writes its own index, and publishes it behind a barrier
+ * once the slot it covers has been written (or read), so neither side ever
+ * waits on the other. A full queue refuses new values instead of growing.
+ */
+template <class T>
+class SpscQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscQueue(size_t capacity = 1024)
+        : head(0)
+        , tail(0)
+    {
+        size_t n = 1;
+        while (n < capacity) {
+            n *= 2;
+        }
+        slots.resize(n);
+        mask = n - 1;
+    }
+
+    // Producer side. Returns false if the queue is full.
+    bool push(const T &value) {
+        size_t t = tail;
+        if (t - head > mask) {
+            return false;
+        }
+        slots[t & mask] = value;
+        __sync_synchronize();
+        tail = t + 1;
+        return true;
+    }
+
+    // Consumer side: the oldest value, without removing it
+    bool peek(T &value) {
+        size_t h = head;
+        if (h == tail) {
+            return false;
+        }
+        __sync_synchronize();
+        value = slots[h & mask];
+        return true;
+    }
+
+    // Consumer side: drops the oldest value
+    void pop() {
+        __sync_synchronize();
+        head = head + 1;
+    }
+
+    // Either side; only a snapshot while the other side is busy
+    size_t size() const {
+        return tail - head;
+    }
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+
+    volatile size_t head;
+    volatile size_t tail;
+};
@@ -0,0 +1,170 @@
+#include <algorithm>
+
+#include "TouchTracker.h"
+
+//---------------------------------------------------------
+TouchTracker::TouchTracker()
+    : nextId(0)
+    , maxDistance(40)
+    , maxMissed(3)
+    , lastTime(0)
+{
+    setNoise(2000, 2);
+}
+
+//---------------------------------------------------------
+void TouchTracker::reset() {
+    touches.clear();
+    filters.clear();
+    lastTime = 0;
+}
+
+//---------------------------------------------------------
+void TouchTracker::setMaxDistance(float distance) {
+    maxDistance = distance;
+}
+
+//---------------------------------------------------------
+void TouchTracker::setMaxMissed(int frames) {
+    maxMissed = frames;
+}
+
+//---------------------------------------------------------
+void TouchTracker::setNoise(float acceleration, float measurement) {
+    q = acceleration * acceleration;
+    r = measurement * measurement;
+}
+
+//---------------------------------------------------------
+void TouchTracker::update(const vector<ofPoint> &points, unsigned long long time) {
+    // Replays can jump backwards when they loop, and the first frame has
+    // nothing to go on, so keep the step to something sane
+    float dt = 1 / 30.0;
+    if (lastTime > 0) {
+        dt = ofClamp((long long) (time - lastTime) / 1000.0, 0.001, 0.2);
+    }
+    lastTime = time;
+
+    for (size_t t = 0; t < touches.size(); t++) {
+        predict(t, dt);
+    }
+
+    // Pair up the closest touches and points first, going by where each
+    // touch should be by now
+    matches.clear();
+    const float maxSquared = maxDistance * maxDistance;
+    for (size_t t = 0; t < touches.size(); t++) {
+        for (size_t p = 0; p < points.size(); p++) {
+            float d = touches[t].point.distanceSquared(points[p]);
+            if (d < maxSquared) {
+                Match m;
+                m.distance = d;
+                m.touch = t;
+                m.point = p;
+                matches.push_back(m);
+            }
+        }
+    }
+    std::sort(matches.begin(), matches.end());
+
+    touchMatched.assign(touches.size(), false);
+    pointMatched.assign(points.size(), false);
+    for (size_t i = 0; i < matches.size(); i++) {
+        const Match &m = matches[i];
+        if (touchMatched[m.touch] || pointMatched[m.point]) {
+            continue;
+        }
+        touchMatched[m.touch] = true;
+        pointMatched[m.point] = true;
+
+        Touch &touch = touches[m.touch];
+        if (touch.active) {
+            correct(m.touch, points[m.point]);
+        } else {
+            start(m.touch, points[m.point]);
+        }
+        touch.active = true;
+        touch.missed = 0;
+    }
+
+    // Hold on to missing touches for a little while, dropping them in place
+    // so the rest stay in ID order. They stay where they were last seen
+    // instead of coasting off.
+    size_t kept = 0;
+    for (size_t t = 0; t < touches.size(); t++) {
+        Touch &touch = touches[t];
+        if (!touchMatched[t]) {
+            touch.active = false;
+            touch.velocity.set(0, 0);
+            if (++touch.missed > maxMissed) {
+                continue;
+            }
+        }
+        touches[kept] = touch;
+        filters[kept] = filters[t];
+        kept++;
+    }
+    touches.resize(kept);
+    filters.resize(kept);
+
+    // Anything left over is a new touch
+    for (size_t p = 0; p < points.size(); p++) {
+        if (!pointMatched[p]) {
+            Touch touch;
+            touch.id = nextId++;
+            touch.active = true;
+            touches.push_back(touch);
+            filters.push_back(Filter());
+            start(touches.size() - 1, points[p]);
+        }
+    }
+}
+
+//---------------------------------------------------------
+const vector<Touch>& TouchTracker::getTouches() {
+    return touches;
+}
+
+//---------------------------------------------------------
+void TouchTracker::start(size_t touch, const ofPoint &point) {
+    touches[touch].point = point;
+    touches[touch].velocity.set(0, 0);
+
+    // Position is as good as one measurement, velocity could be anything
+    // a hand does
+    Filter &f = filters[touch];
+    f.p00 = r;
+    f.p01 = 0;
+    f.p11 = 500 * 500;
+}
+
+//---------------------------------------------------------
+void TouchTracker::predict(size_t touch, float dt) {
+    Touch &t = touches[touch];
+    t.point += t.velocity * dt;
+
+    // P = F P F' + Q, with the acceleration held constant over the step
+    Filter &f = filters[touch];
+    float dt2 = dt * dt;
+    f.p00 += dt * (2 * f.p01 + dt * f.p11) + q * dt2 * dt2 / 4;
+    f.p01 += dt * f.p11 + q * dt2 * dt / 2;
+    f.p11 += q * dt2;
+}
+
+//---------------------------------------------------------
+void TouchTracker::correct(size_t touch, const ofPoint &point) {
+    Touch &t = touches[touch];
+    Filter &f = filters[touch];
+
+    float s = f.p00 + r;
+    float k0 = f.p00 / s;
+    float k1 = f.p01 / s;
+
+    ofPoint innovation = point - t.point;
+    t.point += innovation * k0;
+    t.velocity += innovation * k1;
+
+    f.p11 -= k1 * f.p01;
+    f.p01 -= k0 * f.p01;
+    f.p00 -= k0 * f.p00;
+}
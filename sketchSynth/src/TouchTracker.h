@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ofMain.h"
+
+// One fingertip on the paper, followed from frame to frame
+struct Touch {
+    Touch() : id(-1), active(false), missed(0), contact(true) {}
+
+    // Where the fingertip should be ms milliseconds after its frame
+    ofPoint predict(float ms) const {
+        return point + velocity * (ms / 1000);
+    }
+
+    int id;
+
+    // Filtered position, and velocity in pixels per second
+    ofPoint point;
+    ofPoint velocity;
+
+    // False while the fingertip has briefly gone missing; the touch is kept
+    // for a few frames in case it comes back
+    bool active;
+    int missed;
+
+    // False if a side camera shows the finger hovering over the paper
+    // rather than on it. Always true without one.
+    bool contact;
+};
+
+/*
+ * Gives fingertips IDs that stay the same while they move, by matching each
+ * frame's points to the nearest existing touches. Touches are kept in order
+ * of ID.
+ *
+ * Each touch runs a constant velocity Kalman filter, stepped by the frame
+ * times rather than the frame count, so it smooths out the jitter in the
+ * detected tips the same way at any frame rate, and knows how fast the
+ * finger is going for Touch::predict().
+ */
+class TouchTracker {
+public:
+    TouchTracker();
+
+    void reset();
+
+    // Points further than this from a touch start a new one
+    void setMaxDistance(float distance);
+    void setMaxMissed(int frames);
+
+    // How much the finger's speed can change (process noise, in pixels per
+    // second squared) and how far off each detected tip is (pixels)
+    void setNoise(float acceleration, float measurement);
+
+    // time is the frame's capture time in milliseconds
+    void update(const vector<ofPoint> &points, unsigned long long time);
+    const vector<Touch>& getTouches();
+
+private:
+    struct Match {
+        float distance;
+        size_t touch;
+        size_t point;
+
+        bool operator<(const Match &other) const {
+            return distance < other.distance;
+        }
+    };
+
+    // The x and y filters see the same noise and frame times, so they
+    // always have the same covariance and can share it
+    struct Filter {
+        float p00;
+        float p01;
+        float p11;
+    };
+
+    void start(size_t touch, const ofPoint &point);
+    void predict(size_t touch, float dt);
+    void correct(size_t touch, const ofPoint &point);
+
+    vector<Touch> touches;
+    vector<Filter> filters;
+    int nextId;
+
+    float maxDistance;
+    int maxMissed;
+    float q;
+    float r;
+
+    unsigned long long lastTime;
+
+    vector<Match> matches;
+    vector<bool> touchMatched;
+    vector<bool> pointMatched;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+/*
+ * Lock-free single producer, single consumer handoff of the newest value.
+ *
+ * The writer always owns one slot and the reader always owns another; the
+ * third slot sits in the middle and is swapped atomically with whichever side
+ * wants it. The writer never waits on the reader, so a slow reader just sees
+ * fewer (but always the most recent) values, and stale ones are dropped
+ * instead of queued.
+ */
+template <class T>
+class TripleBuffer {
+public:
+    TripleBuffer()
+        : writeIndex(0)
+        , readIndex(1)
+        , middle(2)
+        , dropped(0)
+    {}
+
+    // Writer side: the slot to fill before calling publish()
+    T& getWriteBuffer() {
+        return slots[writeIndex];
+    }
+
+    // Writer side: hand the write slot to the reader. Returns false if the
+    // previously published value was never read and has been dropped.
+    bool publish() {
+        int old = exchange(writeIndex | NEW_DATA);
+        writeIndex = old & INDEX_MASK;
+        if (old & NEW_DATA) {
+            __sync_fetch_and_add(&dropped, 1);
+            return false;
+        }
+        return true;
+    }
+
+    // Reader side: swap in the newest published value, if there is one
+    bool update() {
+        if (!(middle & NEW_DATA)) {
+            return false;
+        }
+        int old = exchange(readIndex);
+        readIndex = old & INDEX_MASK;
+        return true;
+    }
+
+    // Reader side: the value swapped in by the last successful update()
+    T& getReadBuffer() {
+        return slots[readIndex];
+    }
+
+    unsigned long getDroppedCount() const {
+        return dropped;
+    }
+
+private:
+    int exchange(int value) {
+        int old;
+        do {
+            old = middle;
+        } while (__sync_val_compare_and_swap(&middle, old, value) != old);
+        return old;
+    }
+
+    static const int INDEX_MASK = 3;
+    static const int NEW_DATA = 4;
+
+    T slots[3];
+
+    int writeIndex;
+    int readIndex;
+    volatile int middle;
+    volatile unsigned long dropped;
+};
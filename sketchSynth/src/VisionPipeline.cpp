@@ -0,0 +1,655 @@
+#include "Profiler.h"
+
+#include "VisionPipeline.h"
+
+using namespace ofxCv;
+using namespace cv;
+
+//---------------------------------------------------------
+VisionPipeline::VisionPipeline()
+    : source(NULL)
+    , sheets(1)
+    , mode(VISION_CAPTURE)
+    , epoch(0)
+    , handMargin(80)
+    , paperWidth(0)
+    , paperHeight(0)
+    , unwarpWidth(0)
+    , unwarpScale(1)
+    , frameCount(0)
+    , lastFrameTime(0)
+    , frameRate(0)
+    , playStartTime(0)
+    , restartPlay(false)
+    , request(VISION_CAPTURE)
+    , appliedRequest(VISION_CAPTURE)
+    , requestEpoch(0)
+    , useSide(false)
+    , sideLeft(0)
+    , sideRight(640)
+    , sideTolerance(24)
+    , maxSideSkew(50)
+    , sideDebounce(2)
+    , sideNext(0)
+    , sideCount(0)
+{
+}
+
+//---------------------------------------------------------
+VisionPipeline::~VisionPipeline() {
+    if (isThreadRunning()) {
+        stop();
+    }
+    if (source != NULL) {
+        source->close();
+        delete source;
+    }
+}
+
+//---------------------------------------------------------
+bool VisionPipeline::setup(FrameSource *frameSource, int width, int height) {
+    source = frameSource;
+    if (source == NULL) {
+        source = new CameraFrameSource();
+    }
+    bool ok = source->setup();
+
+    for (size_t i = 0; i < sheets.size(); i++) {
+        sheets[i].paperDetector.setup();
+    }
+    paperWidth = width;
+    paperHeight = height;
+    setUnwarpResolution(width, unwarpScale);
+
+    topBackground.setLearningTime(1800);
+    topBackground.setThresholdValue(40);
+    topBackground.setMaxHold(maxHold);
+
+    return ok;
+}
+
+//---------------------------------------------------------
+void VisionPipeline::start() {
+    if (useSide) {
+        side.start();
+    }
+    startThread(true, false);
+}
+
+//---------------------------------------------------------
+void VisionPipeline::stop() {
+    waitForThread(true);
+    if (useSide) {
+        side.stop();
+    }
+}
+
+//---------------------------------------------------------
+void VisionPipeline::setHandMargin(int margin) {
+    handMargin = margin;
+}
+
+//---------------------------------------------------------
+void VisionPipeline::setSheets(int count) {
+    sheets.resize(max(count, 1));
+    for (size_t i = 0; i < sheets.size(); i++) {
+        sheets[i].paperDetector.setup();
+    }
+    setUnwarpResolution(unwarpWidth, unwarpScale);
+}
+
+//---------------------------------------------------------
+bool VisionPipeline::setSideSource(FrameSource *sideSource) {
+    useSide = side.setup(sideSource);
+    return useSide;
+}
+
+//---------------------------------------------------------
+void VisionPipeline::setSideSurface(int row, int band) {
+    side.getDetector().setSurface(row, band);
+}
+
+//---------------------------------------------------------
+void VisionPipeline::setSideMapping(float left, float right, float tolerance, int maxSkew) {
+    sideLeft = left;
+    sideRight = right;
+    sideTolerance = tolerance;
+    maxSideSkew = maxSkew;
+}
+
+//---------------------------------------------------------
+void VisionPipeline::setSideDebounce(int frames) {
+    sideDebounce = max(frames, 1);
+}
+
+//---------------------------------------------------------
+void VisionPipeline::setUnwarpResolution(int width, float scale) {
+    unwarpWidth = width;
+    unwarpScale = scale;
+    for (size_t i = 0; i < sheets.size(); i++) {
+        Mat &unwarped = sheets[i].unwarped;
+        if (width > 0) {
+            unwarped = Mat::zeros(cvRound(width * (float) paperHeight / paperWidth), width, CV_8UC3);
+        } else if (unwarped.empty()) {
+            unwarped = Mat::zeros(paperHeight, paperWidth, CV_8UC3);
+        }
+    }
+}
+
+//---------------------------------------------------------
+int VisionPipeline::setMode(VisionMode newMode) {
+    requestEpoch++;
+    __sync_lock_test_and_set(&request, (requestEpoch << 2) | newMode);
+    return requestEpoch;
+}
+
+//---------------------------------------------------------
+bool VisionPipeline::update() {
+    return results.update();
+}
+
+//---------------------------------------------------------
+VisionResult& VisionPipeline::getResult() {
+    return results.getReadBuffer();
+}
+
+//---------------------------------------------------------
+unsigned long VisionPipeline::getDroppedFrames() {
+    return results.getDroppedCount();
+}
+
+//---------------------------------------------------------
+unsigned long VisionPipeline::getSkippedFrames() {
+    return source->getSkippedFrames();
+}
+
+//---------------------------------------------------------
+float VisionPipeline::getFrameRate() {
+    return frameRate;
+}
+
+//---------------------------------------------------------
+float VisionPipeline::getSideFrameRate() {
+    return useSide ? side.getFrameRate() : 0;
+}
+
+//---------------------------------------------------------
+int VisionPipeline::getCameraWidth() {
+    return source->getWidth();
+}
+
+//---------------------------------------------------------
+int VisionPipeline::getCameraHeight() {
+    return source->getHeight();
+}
+
+//---------------------------------------------------------
+cv::Rect VisionPipeline::getHandRegion(const vector<cv::Point> &paper, int margin, const cv::Size &frame, const cv::Rect &current) {
+    cv::Rect full(0, 0, frame.width, frame.height);
+    if (paper.size() < 4) {
+        return full;
+    }
+
+    cv::Rect bounds = cv::boundingRect(paper) & full;
+    cv::Rect wanted = cv::Rect(bounds.x - margin, bounds.y - margin,
+            bounds.width + 2 * margin, bounds.height + 2 * margin) & full;
+    if ((wanted & current) == wanted && current.area() <= 2 * wanted.area()) {
+        return current;
+    }
+    return wanted;
+}
+
+//---------------------------------------------------------
+void VisionPipeline::threadedFunction() {
+    while (isThreadRunning()) {
+        applyRequest();
+
+        // Only frames that arrived count as grabs
+        PROFILE_START(grabStart);
+        if (!source->update()) {
+            ofSleepMillis(1);
+            continue;
+        }
+
+        VisionResult &result = results.getWriteBuffer();
+        source->getFrame().copyTo(result.camera);
+        PROFILE_END(PROFILE_GRAB, grabStart);
+
+        process(result);
+        results.publish();
+    }
+}
+
+//---------------------------------------------------------
+void VisionPipeline::applyRequest() {
+    int r = request;
+    if (r == appliedRequest) {
+        return;
+    }
+    appliedRequest = r;
+
+    mode = (VisionMode) (r & 3);
+    epoch = r >> 2;
+
+    // Once the paper is down it only needs to be followed, not found again
+    for (size_t i = 0; i < sheets.size(); i++) {
+        sheets[i].paperDetector.setTracking(mode == VISION_PLAY);
+    }
+
+    if (mode == VISION_PLAY) {
+        // Reset the background to the current image
+        topBackground.reset();
+        if (useSide) {
+            side.reset();
+        }
+
+        // Look for new paper, or paper in a new position
+        for (size_t i = 0; i < sheets.size(); i++) {
+            Sheet &sheet = sheets[i];
+            sheet.found = false;
+            sheet.paperDetector.forget();
+            sheet.touchTracker.reset();
+            sheet.contacts.clear();
+        }
+
+        // Timed against the frames, so replays behave the same at any speed
+        restartPlay = true;
+    }
+}
+
+//---------------------------------------------------------
+void VisionPipeline::process(VisionResult &result) {
+    unsigned long long now = ofGetElapsedTimeMillis();
+    if (lastFrameTime > 0 && now > lastFrameTime) {
+        frameRate = 0.9 * frameRate + 0.1 * (1000.0 / (now - lastFrameTime));
+    }
+    lastFrameTime = now;
+
+    Mat camera = source->getFrame();
+    unsigned long long time = source->getTimestamp();
+    if (restartPlay) {
+        playStartTime = time;
+        restartPlay = false;
+    }
+
+    result.frame = ++frameCount;
+    result.time = time;
+    result.received = now;
+    result.mode = mode;
+    result.epoch = epoch;
+    result.tracked = false;
+    result.sideMatched = false;
+    result.sheets.resize(sheets.size());
+    for (size_t i = 0; i < sheets.size(); i++) {
+        result.sheets[i].touches.clear();
+    }
+
+    // Side frames are picked up in every mode so none go stale in the queue
+    if (useSide) {
+        pollSide();
+    }
+
+    switch (mode) {
+        case VISION_PAPER: {
+            PROFILE_SCOPE(PROFILE_PAPER_DETECT);
+            detectPaper(camera);
+            for (size_t i = 0; i < sheets.size(); i++) {
+                sheets[i].found = sheets[i].seen;
+            }
+            break;
+        }
+        case VISION_PLAY:
+            // Give the camera some time to settle before learning the background
+            if (time - playStartTime > toPlayDelay) {
+                processPlay(camera, result);
+            }
+            break;
+        default:
+            break;
+    }
+
+    for (size_t i = 0; i < sheets.size(); i++) {
+        Sheet &sheet = sheets[i];
+        SheetResult &out = result.sheets[i];
+        out.found = sheet.found;
+        out.paper = sheet.paperDetector.getQuad();
+        out.tracking = sheet.paperDetector.isTracking();
+        out.confidence = sheet.paperDetector.getConfidence();
+    }
+    result.hands = handDetector.getHands();
+}
+
+//---------------------------------------------------------
+void VisionPipeline::processPlay(Mat camera, VisionResult &result) {
+    /*
+     * We need unwarped images for accurate hand coordinates, but hands can
+     * distort the bounding rectangle. The detector tracks the corners in
+     * play mode and fills in one that's covered from the other three, so
+     * the quad only gets searched for again if tracking is lost.
+     */
+    // Look for paper and if we have it, unwarp the image
+    {
+        PROFILE_SCOPE(PROFILE_PAPER_DETECT);
+        detectPaper(camera);
+    }
+    const int n = sheets.size();
+    corners.clear();
+    papers.resize(n);
+    for (int i = 0; i < n; i++) {
+        Sheet &sheet = sheets[i];
+        if (sheet.seen && !sheet.found && unwarpWidth == 0) {
+            fitUnwarped(sheet);
+        }
+        sheet.found = sheet.found || sheet.seen;
+        if (sheet.found) {
+            const vector<Point> &quad = sheet.paperDetector.getQuad();
+            corners.insert(corners.end(), quad.begin(), quad.end());
+        }
+        papers[i] = sheet.paperDetector.getPaper();
+    }
+
+    // Fingers only count on the paper, so only look for hands around it
+    Rect region(0, 0, camera.cols, camera.rows);
+    if (!corners.empty()) {
+        region = getHandRegion(corners, handMargin, camera.size(), handRegion);
+    }
+    handRegion = region;
+
+    {
+        // Only the green channel is used. Around the hands found last frame
+        // isn't learned, so a hand resting on the paper doesn't fade into
+        // the background, but a shadow or something moved still is. The
+        // model covers the whole frame, so when the region moves with the
+        // paper only the strip it newly takes in starts over, not the
+        // background under the hand that's moving it.
+        PROFILE_SCOPE(PROFILE_BACKGROUND);
+        topBackground.update(camera, handRegion, 1, foreground, handDetector.getHoldMask(holdMargin, handRegion));
+    }
+    handDetector.detect(foreground, papers, handRegion.tl());
+
+    // Every fingertip on the paper goes to its sheet
+    const vector<Hand> &hands = handDetector.getHands();
+    for (int i = 0; i < n; i++) {
+        sheets[i].tips.clear();
+    }
+    for (size_t h = 0; h < hands.size(); h++) {
+        for (size_t i = 0; i < hands[h].tips.size(); i++) {
+            int s = findSheet(hands[h].tips[i]);
+            if (s >= 0) {
+                sheets[s].tips.push_back(hands[h].tips[i]);
+            }
+        }
+    }
+
+    result.sideMatched = useSide && matchSide(result.time);
+
+    // Then each sheet is unwarped and its fingertips moved onto the paper
+    // and given IDs, on as many cores as there are sheets. That's timed as
+    // a whole, from this thread, so unwarp stays one span a frame however
+    // many sheets there are.
+    PROFILE_START(unwarpStart);
+    #pragma omp parallel for schedule(dynamic, 1) if (n > 1)
+    for (int i = 0; i < n; i++) {
+        Sheet &sheet = sheets[i];
+        SheetResult &out = result.sheets[i];
+        if (sheet.found) {
+            sheet.paperDetector.unwarp(sheet.unwarped);
+        }
+
+        const Homography &toPaper = sheet.paperDetector.getHomography(paperWidth, paperHeight);
+        for (size_t t = 0; t < sheet.tips.size(); t++) {
+            sheet.tips[t] = toPaper.map(sheet.tips[t]);
+        }
+        sheet.touchTracker.update(sheet.tips, result.time);
+        out.touches = sheet.touchTracker.getTouches();
+        if (useSide) {
+            confirmContacts(sheet, out.touches, toPaper, result.sideMatched);
+        }
+
+        sheet.unwarped.copyTo(out.unwarped);
+        if (sheet.found) {
+            out.paperTransform = toPaper.inverse();
+        }
+    }
+    PROFILE_END(PROFILE_UNWARP, unwarpStart);
+
+    result.tracked = true;
+    result.handRegion = handRegion;
+    foreground.copyTo(result.foreground);
+    handDetector.getDetectorInput().copyTo(result.handInput);
+}
+
+//---------------------------------------------------------
+void VisionPipeline::detectPaper(Mat camera) {
+    if (sheets.size() == 1) {
+        sheets[0].seen = sheets[0].paperDetector.detect(camera);
+        return;
+    }
+
+    // Sheets that are locked on follow their own corners, each on a core of
+    // its own
+    const int n = sheets.size();
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int i = 0; i < n; i++) {
+        sheets[i].seen = sheets[i].paperDetector.follow(camera);
+    }
+
+    // One search turns up every rectangle for the rest to claim. In play,
+    // sheets that have been found before get first pick, where they were or
+    // close by, so a new one can't take the place of one that just lost
+    // tracking. Looking for paper, sheets get lifted and put down anywhere,
+    // so they just take the nearest.
+    int searcher = -1;
+    for (int i = 0; i < n && searcher < 0; i++) {
+        if (!sheets[i].seen) {
+            searcher = i;
+        }
+    }
+    if (searcher < 0) {
+        return;
+    }
+    sheets[searcher].paperDetector.findCandidates(camera, candidates);
+    dropCandidates(true);
+    if (mode == VISION_PLAY) {
+        for (int i = 0; i < n; i++) {
+            Sheet &sheet = sheets[i];
+            if (!sheet.seen && sheet.paperDetector.hasPaper()) {
+                sheet.seen = sheet.paperDetector.claim(camera, candidates);
+            }
+        }
+        claimNearest(camera, true);
+        dropCandidates(false);
+    } else {
+        claimNearest(camera, false);
+    }
+    for (int i = 0; i < n; i++) {
+        Sheet &sheet = sheets[i];
+        if (!sheet.seen && !sheet.paperDetector.hasPaper()) {
+            sheet.seen = sheet.paperDetector.claim(camera, candidates);
+        }
+    }
+}
+
+//---------------------------------------------------------
+void VisionPipeline::dropCandidates(bool seen) {
+    // Leaves out the rectangles that are already a sheet's, either ones seen
+    // in this frame, or with seen false, where any sheet was last
+    size_t kept = 0;
+    for (size_t c = 0; c < candidates.size(); c++) {
+        bool taken = false;
+        for (size_t i = 0; i < sheets.size() && !taken; i++) {
+            PaperDetector &detector = sheets[i].paperDetector;
+            if ((!seen || sheets[i].seen) && detector.hasPaper()) {
+                taken = cv::pointPolygonTest(Mat(candidates[c]), detector.getCenter(), false) >= 0;
+            }
+        }
+        if (!taken) {
+            candidates[kept++].swap(candidates[c]);
+        }
+    }
+    candidates.resize(kept);
+}
+
+//---------------------------------------------------------
+void VisionPipeline::claimNearest(Mat camera, bool limited) {
+    // Closest pairs of sheet and rectangle first, so two sheets that both
+    // moved don't swap
+    candidateCenters.resize(candidates.size());
+    for (size_t c = 0; c < candidates.size(); c++) {
+        Point2f center;
+        for (size_t k = 0; k < candidates[c].size(); k++) {
+            center += Point2f(candidates[c][k].x, candidates[c][k].y);
+        }
+        candidateCenters[c] = center * (1.0f / max((int) candidates[c].size(), 1));
+    }
+
+    while (!candidates.empty()) {
+        int bestSheet = -1;
+        size_t bestCandidate = 0;
+        float bestDistance = numeric_limits<float>::infinity();
+        for (size_t i = 0; i < sheets.size(); i++) {
+            PaperDetector &detector = sheets[i].paperDetector;
+            if (sheets[i].seen || !detector.hasPaper()) {
+                continue;
+            }
+            Point2f center = detector.getCenter();
+            float reach = limited ? detector.getReach() : numeric_limits<float>::infinity();
+            for (size_t c = 0; c < candidates.size(); c++) {
+                float distance = cv::norm(candidateCenters[c] - center);
+                if (distance <= reach && distance < bestDistance) {
+                    bestSheet = i;
+                    bestCandidate = c;
+                    bestDistance = distance;
+                }
+            }
+        }
+        if (bestSheet < 0) {
+            return;
+        }
+        sheets[bestSheet].paperDetector.take(camera, candidates, bestCandidate);
+        sheets[bestSheet].seen = true;
+        candidateCenters.erase(candidateCenters.begin() + bestCandidate);
+    }
+}
+
+//---------------------------------------------------------
+int VisionPipeline::findSheet(const ofPoint &tip) {
+    // With one sheet every tip is already on it
+    if (sheets.size() == 1) {
+        return 0;
+    }
+    for (size_t i = 0; i < sheets.size(); i++) {
+        if (sheets[i].found && ShapeUtils::inside(papers[i], tip.x, tip.y)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+//---------------------------------------------------------
+void VisionPipeline::fitUnwarped(Sheet &sheet) {
+    // The camera's view of the paper is a perspective quad, so average each
+    // pair of opposite sides and size the width from the longer pair
+    const vector<Point> &quad = sheet.paperDetector.getQuad();
+    if (quad.size() != 4) {
+        return;
+    }
+    double a = cv::norm(quad[1] - quad[0]) + cv::norm(quad[3] - quad[2]);
+    double b = cv::norm(quad[2] - quad[1]) + cv::norm(quad[0] - quad[3]);
+    int width = cvRound(max(a, b) / 2 * unwarpScale);
+    width = ofClamp(width, minUnwarpWidth, maxUnwarpWidth);
+    int height = cvRound(width * (float) paperHeight / paperWidth);
+    if (sheet.unwarped.cols != width || sheet.unwarped.rows != height) {
+        sheet.unwarped = Mat::zeros(height, width, CV_8UC3);
+    }
+}
+
+//---------------------------------------------------------
+void VisionPipeline::pollSide() {
+    SideContacts contacts;
+    while (side.poll(contacts)) {
+        sideHistory[sideNext] = contacts;
+        sideNext = (sideNext + 1) % sideHistorySize;
+        sideCount = min(sideCount + 1, (int) sideHistorySize);
+    }
+}
+
+//---------------------------------------------------------
+bool VisionPipeline::matchSide(unsigned long long time) {
+    // The nearest side frame, whether it came before or after this one
+    int best = -1;
+    unsigned long long bestSkew = 0;
+    for (int i = 0; i < sideCount; i++) {
+        unsigned long long t = sideHistory[i].time;
+        unsigned long long skew = t > time ? t - time : time - t;
+        if (skew <= (unsigned long long) maxSideSkew && (best < 0 || skew < bestSkew)) {
+            best = i;
+            bestSkew = skew;
+        }
+    }
+    if (best < 0) {
+        return false;
+    }
+    sideMatch = sideHistory[best];
+    return true;
+}
+
+//---------------------------------------------------------
+bool VisionPipeline::seesContact(const Touch &touch, const Homography &toPaper) {
+    // Across the table maps onto across the side image. Depth is lost, so
+    // fingers further from the side camera land a little off, which the
+    // tolerance makes up for.
+    float scale = (sideRight - sideLeft) / source->getWidth();
+    float column = sideLeft + scale * toPaper.unmap(touch.point).x;
+    for (int i = 0; i < sideMatch.count; i++) {
+        if (fabsf(sideMatch.columns[i] - column) <= sideTolerance) {
+            return true;
+        }
+    }
+    return false;
+}
+
+//---------------------------------------------------------
+void VisionPipeline::confirmContacts(Sheet &sheet, vector<Touch> &touches, const Homography &toPaper, bool matched) {
+    // A finger right at the edge of the band comes and goes from one side
+    // frame to the next, so a touch only changes state once several side
+    // frames in a row agree. Frames without a side frame to go by change
+    // nothing, and a new touch hovers until one says otherwise.
+    vector<ContactState> &last = sheet.contacts;
+    vector<ContactState> &next = sheet.nextContacts;
+    next.clear();
+    size_t s = 0;
+    for (size_t t = 0; t < touches.size(); t++) {
+        Touch &touch = touches[t];
+        for (; s < last.size() && last[s].id < touch.id; s++) {}
+
+        ContactState state;
+        bool known = s < last.size() && last[s].id == touch.id;
+        if (known) {
+            state = last[s];
+        } else {
+            state.id = touch.id;
+            state.contact = false;
+            state.disagreed = 0;
+            state.sideTime = 0;
+        }
+
+        // Each side frame only counts once per touch, however many top
+        // frames it's the nearest to
+        if (matched && touch.active && sideMatch.time != state.sideTime) {
+            state.sideTime = sideMatch.time;
+            bool seen = seesContact(touch, toPaper);
+            if (!known) {
+                state.contact = seen;
+            } else if (seen == state.contact) {
+                state.disagreed = 0;
+            } else if (++state.disagreed >= sideDebounce) {
+                state.contact = seen;
+                state.disagreed = 0;
+            }
+        }
+        touch.contact = state.contact;
+        next.push_back(state);
+    }
+    last.swap(next);
+}
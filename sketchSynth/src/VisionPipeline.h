@@ -0,0 +1,258 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxCv.h"
+
+#include "BackgroundModel.h"
+#include "FrameSource.h"
+#include "HandDetector.h"
+#include "PaperDetector.h"
+#include "SidePipeline.h"
+#include "TouchTracker.h"
+#include "TripleBuffer.h"
+
+enum VisionMode { VISION_CAPTURE, VISION_PAPER, VISION_PLAY };
+
+// One sheet of paper, with its own paper coordinates
+struct SheetResult {
+    SheetResult()
+        : found(false)
+        , tracking(false)
+        , confidence(0)
+    {}
+
+    bool found;
+    vector<cv::Point> paper;
+    // Paper coordinates to camera coordinates
+    Homography paperTransform;
+
+    // True if the paper corners were tracked rather than searched for
+    bool tracking;
+    float confidence;
+
+    cv::Mat unwarped;
+
+    // Fingertips on this sheet, in its paper coordinates, as of the frame
+    vector<Touch> touches;
+};
+
+// Everything the render thread needs from one processed camera frame
+struct VisionResult {
+    VisionResult()
+        : frame(0)
+        , time(0)
+        , received(0)
+        , mode(VISION_CAPTURE)
+        , epoch(0)
+        , tracked(false)
+        , sideMatched(false)
+    {}
+
+    unsigned long frame;
+    unsigned long long time;
+    // When the vision thread got the frame, by ofGetElapsedTimeMillis()
+    unsigned long long received;
+    VisionMode mode;
+    int epoch;
+
+    // True if hand tracking ran on this frame
+    bool tracked;
+    // True if touches were checked against a side camera frame
+    bool sideMatched;
+
+    cv::Mat camera;
+
+    // Hand detection only looks at this part of the camera frame, and the
+    // foreground and hand input images cover just this region
+    cv::Rect handRegion;
+    cv::Mat foreground;
+    cv::Mat handInput;
+
+    // Always one for each sheet the pipeline looks for, found or not
+    vector<SheetResult> sheets;
+
+    vector<Hand> hands;
+};
+
+/*
+ * Owns the frame source and runs paper and hand detection on its own thread,
+ * so vision runs at the camera's rate no matter how long drawing takes. Only
+ * the newest result is kept; the render thread picks it up with update().
+ *
+ * Several sheets can share the camera. Each is tracked, unwarped and given
+ * its touches on a core of its own, and a fingertip goes to the sheet it's
+ * on. Sheets keep their number for as long as play runs: one that loses
+ * tracking takes back a rectangle where it was last seen, or failing that
+ * the nearest one within half its size. Outside of play nothing is pinned,
+ * and each sheet takes whichever rectangle is nearest to where it was.
+ *
+ * With a side camera, touches are also checked against its contacts. That
+ * camera has a pipeline of its own, and each top camera frame takes the side
+ * frame nearest to it in time out of those already processed, never waiting
+ * for one, so the check adds no latency.
+ */
+class VisionPipeline : public ofThread {
+public:
+    VisionPipeline();
+    ~VisionPipeline();
+
+    // Takes ownership of the source. Without one, the default camera is used.
+    // Touches and the paper transform are in paper coordinates, which are
+    // width by height, and so is the unwarped image unless it's changed.
+    bool setup(FrameSource *source, int width, int height);
+    void start();
+    void stop();
+
+    // Call before start()
+    void setHandMargin(int margin);
+    void setSheets(int count);
+
+    // Call after setup() and before start(). Takes ownership of the source.
+    bool setSideSource(FrameSource *source);
+    // The row the side camera sees the paper's surface at, and how many rows
+    // above it count as touching
+    void setSideSurface(int row, int band);
+    // The side image columns the left and right edges of the top camera's
+    // view line up with, how many columns a contact can be from where a
+    // touch should be, and how many milliseconds apart the two frames can
+    // be. Touches without a side frame that close aren't checked.
+    void setSideMapping(float left, float right, float tolerance, int maxSkew);
+    // Side frames in a row that have to disagree with a touch before it
+    // goes from touching to hovering or back
+    void setSideDebounce(int frames);
+
+    // Call before start(). The unwarped image keeps the paper's proportions
+    // but is width pixels across, or with width 0, as many as the paper's
+    // long sides cover in the camera image times scale, measured each time
+    // play finds the paper.
+    void setUnwarpResolution(int width, float scale);
+
+    // Switch modes, starting with the next camera frame. Returns the epoch
+    // that results produced in the new mode will carry.
+    int setMode(VisionMode mode);
+
+    bool update();
+    VisionResult& getResult();
+
+    unsigned long getDroppedFrames();
+    unsigned long getSkippedFrames();
+    float getFrameRate();
+    // 0 without a side camera
+    float getSideFrameRate();
+
+    int getCameraWidth();
+    int getCameraHeight();
+
+    // The bounding box of the paper's corners, of one sheet or several, plus
+    // a margin. The current region is kept for as long as the paper and its
+    // whole margin still fit in it and it isn't much too big, so a little
+    // movement doesn't change it every frame.
+    static cv::Rect getHandRegion(const vector<cv::Point> &paper, int margin, const cv::Size &frame, const cv::Rect &current);
+
+protected:
+    void threadedFunction();
+
+private:
+    // Whether a touch is on the paper, as of the side frames so far
+    struct ContactState {
+        int id;
+        bool contact;
+        // Side frames in a row that said otherwise
+        int disagreed;
+        // Capture time of the last side frame counted, since the same one
+        // is matched to every top frame near it
+        unsigned long long sideTime;
+    };
+
+    // The vision thread's side of one sheet
+    struct Sheet {
+        Sheet() : seen(false), found(false) {}
+
+        PaperDetector paperDetector;
+        TouchTracker touchTracker;
+        // Seen in this frame, and found at all this play session
+        bool seen;
+        bool found;
+        cv::Mat unwarped;
+        vector<ofPoint> tips;
+
+        // In order of touch ID, like the touches
+        vector<ContactState> contacts;
+        vector<ContactState> nextContacts;
+    };
+
+    void applyRequest();
+    void process(VisionResult &result);
+    void processPlay(cv::Mat camera, VisionResult &result);
+    void detectPaper(cv::Mat camera);
+    void dropCandidates(bool seen);
+    void claimNearest(cv::Mat camera, bool limited);
+    int findSheet(const ofPoint &tip);
+    void fitUnwarped(Sheet &sheet);
+    void pollSide();
+    bool matchSide(unsigned long long time);
+    bool seesContact(const Touch &touch, const Homography &toPaper);
+    void confirmContacts(Sheet &sheet, vector<Touch> &touches, const Homography &toPaper, bool matched);
+
+    FrameSource *source;
+
+    vector<Sheet> sheets;
+    vector< vector<cv::Point> > candidates;
+    vector<cv::Point2f> candidateCenters;
+    vector<ofPolyline> papers;
+    vector<cv::Point> corners;
+
+    HandDetector handDetector;
+
+    BackgroundModel topBackground;
+    cv::Rect handRegion;
+    int handMargin;
+    cv::Mat foreground;
+
+    // Pixels around each hand kept out of the background, for at most
+    // maxHold frames
+    static const int holdMargin = 12;
+    static const int maxHold = 300;
+
+    int paperWidth;
+    int paperHeight;
+    int unwarpWidth;
+    float unwarpScale;
+
+    static const int minUnwarpWidth = 256;
+    static const int maxUnwarpWidth = 4096;
+
+    VisionMode mode;
+    int epoch;
+
+    unsigned long frameCount;
+    unsigned long long lastFrameTime;
+    float frameRate;
+
+    unsigned long long playStartTime;
+    bool restartPlay;
+    static const int toPlayDelay = 250;
+
+    // Mode requests from the render thread, packed as (epoch << 2) | mode
+    volatile int request;
+    int appliedRequest;
+    int requestEpoch;
+
+    TripleBuffer<VisionResult> results;
+
+    SidePipeline side;
+    bool useSide;
+    float sideLeft;
+    float sideRight;
+    float sideTolerance;
+    int maxSideSkew;
+    int sideDebounce;
+
+    // The side frames most recently picked up, and the one matched to the
+    // current top camera frame
+    static const int sideHistorySize = 16;
+    SideContacts sideHistory[sideHistorySize];
+    int sideNext;
+    int sideCount;
+    SideContacts sideMatch;
+};
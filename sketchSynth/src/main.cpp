@@ -1,8 +1,74 @@
 #include "SketchSynth.h"
 #include "ofAppGlutWindow.h"
 
-int main() {
+int main(int argc, char *argv[]) {
+    string replayPath;
+    bool realtime = true;
+    bool loop = false;
+    int device = 0;
+    bool headless = false;
+    int controlPort = DEFAULT_CONTROL_PORT;
+    string sideReplayPath;
+    int sideDevice = -1;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--fast") {
+            realtime = false;
+        } else if (arg == "--loop") {
+            loop = true;
+        } else if (arg == "--device" && i + 1 < argc) {
+            device = ofToInt(argv[++i]);
+        } else if (arg == "--side-replay" && i + 1 < argc) {
+            sideReplayPath = argv[++i];
+        } else if (arg == "--side-device" && i + 1 < argc) {
+            sideDevice = ofToInt(argv[++i]);
+        } else if (arg == "--headless") {
+            headless = true;
+        } else if (arg == "--control-port" && i + 1 < argc) {
+            controlPort = ofToInt(argv[++i]);
+        } else {
+            ofLog(OF_LOG_WARNING, "Ignoring unknown argument " + arg);
+        }
+    }
+
+    // The cameras' frames are matched by capture time, so both have to be
+    // on one clock: live cameras on the app's, recordings on their own,
+    // released on their original schedule
+    bool sideReplay = !sideReplayPath.empty();
+    if (sideReplay || sideDevice >= 0) {
+        if (sideReplay == replayPath.empty()) {
+            ofLog(OF_LOG_ERROR, "Use --side-replay with --replay and --side-device with a live camera, not one of each.");
+            return 1;
+        }
+        if (sideReplay && !realtime) {
+            ofLog(OF_LOG_ERROR, "--side-replay can't be used with --fast.");
+            return 1;
+        }
+    }
+
+    FrameSource *source;
+    if (replayPath.empty()) {
+        source = new CameraFrameSource(640, 480, device);
+    } else {
+        source = new ReplayFrameSource(replayPath, realtime, loop);
+    }
+
+    FrameSource *sideSource = NULL;
+    if (!sideReplayPath.empty()) {
+        sideSource = new ReplayFrameSource(sideReplayPath, realtime, loop);
+    } else if (sideDevice >= 0) {
+        sideSource = new CameraFrameSource(640, 480, sideDevice);
+    }
+
+    if (headless) {
+        SketchSynth app(source, true, sideSource);
+        return app.runHeadless(controlPort);
+    }
+
 	ofAppGlutWindow window;
 	ofSetupOpenGL(&window, 2128, 800, OF_FULLSCREEN);
-	ofRunApp(new SketchSynth());
+	ofRunApp(new SketchSynth(source, false, sideSource));
 }